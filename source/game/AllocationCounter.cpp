@@ -0,0 +1,40 @@
+#include <new>
+#include <stdlib.h>
+
+#include "AllocationCounter.h"
+
+static thread_local bool counting = false;
+static thread_local uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+    if (counting) {
+        ++allocations;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void start_counting_allocations() {
+    allocations = 0;
+    counting = true;
+}
+
+uint64_t stop_counting_allocations() {
+    counting = false;
+    return allocations;
+}
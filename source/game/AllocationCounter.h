@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ Counts the heap allocations of the calling thread, for tests that hold
+ code to not allocating. Global operator new is replaced with one that
+ counts while the thread counts and allocates with malloc either way.
+ It is linked into the tests executable only, see TEST_ONLY_SOURCES in the
+ makefile, so the game and the tools keep the standard allocator.
+ */
+void start_counting_allocations();
+//@result the allocations since start_counting_allocations()
+uint64_t stop_counting_allocations();
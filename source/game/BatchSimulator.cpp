@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "BatchSimulator.h"
+#include "StdLibRandomProvider.h"
+
+BatchConfig::BatchConfig() {
+    games = 1000;
+    max_ticks = 100000;
+    seed = 1;
+    threads = 0;
+    policy = BatchSimulator::random_policy;
+}
+
+double BatchReport::games_per_second() const {
+    return seconds > 0 ? games / seconds : 0;
+}
+
+double BatchReport::ticks_per_second() const {
+    return seconds > 0 ? ticks / seconds : 0;
+}
+
+BatchSimulator::BatchSimulator(const BatchConfig& config) :
+config(config),
+pool(config.threads) {
+}
+
+BatchSimulator::~BatchSimulator() {
+}
+
+unsigned BatchSimulator::game_seed(unsigned seed, int game) {
+    //splitmix64 finalizer, neighbouring games get unrelated streams
+    unsigned long long z = ((unsigned long long) seed << 32) + (unsigned) game;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (unsigned) (z ^ (z >> 31));
+}
+
+void BatchSimulator::random_policy(TetrisGame& game, RandomNumberProvider& rnd) {
+    switch (rnd.next_int(6)) {
+        case 1: game.rotate();
+            break;
+        case 2: game.move_left();
+            break;
+        case 3: game.move_right();
+            break;
+    }
+}
+
+void BatchSimulator::run_game(int game, WorkerStats& stats, std::vector<int>& scores) {
+    StdLibRandomProvider inputs(game_seed(~config.seed, game));
+    TetrisGame g(PieceQueue(config.seed, game));
+    int tick = 0;
+    while (tick < config.max_ticks) {
+        if (config.policy) {
+            config.policy(g, inputs);
+        }
+        tick++;
+        if (GAME_OVER == g.process()) {
+            stats.game_overs++;
+            break;
+        }
+    }
+    stats.ticks += tick;
+    scores[game] = g.get_score();
+}
+
+BatchReport BatchSimulator::run() {
+    BatchReport report;
+    report.games = config.games;
+    report.scores.assign(config.games, 0);
+    std::vector<WorkerStats> stats(pool.size());
+    for (auto & s : stats) {
+        s.ticks = 0;
+        s.game_overs = 0;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    pool.parallel_for(0, config.games, 1, [this, &stats, &report](int begin, int end, int worker) {
+        for (int game = begin; game < end; ++game) {
+            run_game(game, stats[worker], report.scores);
+        }
+    });
+    auto finished = std::chrono::steady_clock::now();
+    report.seconds = std::chrono::duration<double>(finished - started).count();
+
+    report.ticks = 0;
+    report.game_overs = 0;
+    for (auto & s : stats) {
+        report.ticks += s.ticks;
+        report.game_overs += s.game_overs;
+    }
+    report.min_score = 0;
+    report.max_score = 0;
+    report.mean_score = 0;
+    report.stddev_score = 0;
+    if (config.games > 0) {
+        report.min_score = *std::min_element(report.scores.begin(), report.scores.end());
+        report.max_score = *std::max_element(report.scores.begin(), report.scores.end());
+        double sum = 0;
+        for (int s : report.scores) {
+            sum += s;
+        }
+        report.mean_score = sum / config.games;
+        double sq = 0;
+        for (int s : report.scores) {
+            sq += (s - report.mean_score) * (s - report.mean_score);
+        }
+        report.stddev_score = std::sqrt(sq / config.games);
+    }
+    return report;
+}
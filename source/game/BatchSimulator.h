@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "TetrisGame.h"
+#include "ThreadPool.h"
+
+//chooses the input for the next tick of a game, `rnd` belongs to that game only
+typedef void (*batch_policy)(TetrisGame& game, RandomNumberProvider& rnd);
+
+struct BatchConfig {
+    int games;
+    //a game stops on game over or after this many ticks
+    int max_ticks;
+    unsigned seed;
+    //0 means one per hardware thread
+    int threads;
+    batch_policy policy;
+
+    BatchConfig();
+};
+
+struct BatchReport {
+    int games;
+    int game_overs;
+    long long ticks;
+    double seconds;
+    int min_score;
+    int max_score;
+    double mean_score;
+    double stddev_score;
+    //score of every game, by game index
+    std::vector<int> scores;
+
+    double games_per_second() const;
+    double ticks_per_second() const;
+};
+
+/*
+ Runs many independent games without any rendering.
+
+ Game k draws its figures and inputs from its own generators seeded from
+ (seed, k), so the results depend on the config only and not on the number
+ of threads or the order the games were picked up in.
+ */
+class BatchSimulator {
+public:
+    BatchSimulator(const BatchConfig& config);
+    virtual ~BatchSimulator();
+
+    virtual BatchReport run();
+
+    static unsigned game_seed(unsigned seed, int game);
+    static void random_policy(TetrisGame& game, RandomNumberProvider& rnd);
+private:
+    BatchConfig config;
+    ThreadPool pool;
+
+    //ticks counted per worker, padded so that workers never share a cache line
+    struct WorkerStats {
+        long long ticks;
+        int game_overs;
+        char padding[64];
+    };
+
+    void run_game(int game, WorkerStats& stats, std::vector<int>& scores);
+};
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "BeamSearchBot.h"
+
+//value of a board the next figure can not even spawn on
+#define LOST_VALUE -1e9f
+
+BotWeights::BotWeights() {
+    height = -0.51f;
+    lines = 0.76f;
+    holes = -0.36f;
+    bumpiness = -0.18f;
+}
+
+BotConfig::BotConfig() {
+    width = 16;
+    depth = 2;
+    threads = 0;
+    budget = 0;
+    table = 1;
+}
+
+template <int Rows, int Cols>
+BasicBeamSearchBot<Rows, Cols>::BasicBeamSearchBot(const BotConfig& config, int rows, int cols) :
+config(config),
+field_rows(rows),
+field_cols(cols),
+states((MAX_ROTATION_INDEX + 1) * rows * cols),
+pool(config.threads),
+root_finder(rows, cols),
+table(config.table),
+searches(0) {
+    this->config.width = std::max(1, config.width);
+    this->config.depth = std::min(std::max(1, config.depth), BOT_MAX_DEPTH);
+    int width = this->config.width;
+    workers.reserve(pool.size());
+    for (int k = 0; k < pool.size(); ++k) {
+        workers.push_back(Worker(rows, cols));
+        workers.back().kept.reserve(width + 1);
+    }
+    beam.reserve(std::max(width, states));
+    next.reserve(std::max(width * pool.size(), states));
+    expired = false;
+}
+
+template <int Rows, int Cols>
+BasicBeamSearchBot<Rows, Cols>::~BasicBeamSearchBot() {
+}
+
+template <int Rows, int Cols>
+bool BasicBeamSearchBot<Rows, Cols>::think(const game_type& game, move_type& move, const figure_shape* const* preview, int previews) {
+    assert(game.get_field_rows() == field_rows && game.get_field_cols() == field_cols);
+    long long deadline = config.budget > 0 ? now() + config.budget * 1000LL : 0;
+    expired = false;
+    int found = root_finder.find(game);
+    if (!found) {
+        return false;
+    }
+
+    figures[0] = game.get_figure();
+    for (int level = 1; level < config.depth; ++level) {
+        figures[level] = level <= previews ? preview[level - 1] : 0;
+    }
+    //the workers' games only need the board, any queue position restores it
+    game_state state;
+    game.save(state);
+    state.position = 1;
+    for (auto & w : workers) {
+        w.game.restore(state);
+    }
+    root_score = state.score;
+    searches++;
+    table.new_search();
+
+    //level 0, the falling figure from where it is now
+    Worker& first = workers[0];
+    next.clear();
+    for (int p = 0; p < found; ++p) {
+        Node child;
+        child.path[0] = root_finder.get(p);
+        child.root = p;
+        child.order = (uint32_t) p;
+        settle(first, 0, child);
+        next.push_back(child);
+    }
+    select(config.width);
+    move.levels = 1;
+
+    for (int level = 1; level < config.depth; ++level) {
+        if (!figures[level]) {
+            //the figure is unknown, score every board by what any figure does next
+            next.assign(beam.begin(), beam.end());
+            pool.parallel_for(0, (int) beam.size(), 1, [&](int begin, int end, int worker) {
+                Worker& w = workers[worker];
+                for (int k = begin; k < end && !is_expired(deadline); ++k) {
+                    walk(w, beam[k], level);
+                    next[k].value = expected(w);
+                    unwalk(w, level);
+                }
+            });
+            if (!expired) {
+                std::sort(next.begin(), next.end(), better);
+                beam.assign(next.begin(), next.end());
+                move.levels++;
+            }
+            break;
+        }
+        for (auto & w : workers) {
+            w.kept.clear();
+        }
+        pool.parallel_for(0, (int) beam.size(), 1, [&](int begin, int end, int worker) {
+            for (int k = begin; k < end && !is_expired(deadline); ++k) {
+                expand(beam[k], k, level, workers[worker]);
+            }
+        });
+        next.clear();
+        for (auto & w : workers) {
+            next.insert(next.end(), w.kept.begin(), w.kept.end());
+        }
+        //a level cut short by the budget, or with every board lost, is thrown away
+        if (expired || next.empty()) {
+            break;
+        }
+        select(config.width);
+        move.levels++;
+    }
+
+    const Node& best = beam.front();
+    move.target = root_finder.get(best.root);
+    move.value = best.value;
+    move.length = root_finder.inputs(best.root, move.inputs, finder_type::states);
+    return true;
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::expand(const Node& parent, int index, int level, Worker& worker) {
+    walk(worker, parent, level);
+    int found = worker.finder.find(worker.game.get_rows(), figures[level], 0, 0, SPAWN_COL_OF(field_cols));
+    for (int p = 0; p < found; ++p) {
+        Node child = parent;
+        child.path[level] = worker.finder.get(p);
+        child.order = (uint32_t) index * states + p;
+        settle(worker, level, child);
+        keep(worker, level, child);
+    }
+    unwalk(worker, level);
+}
+
+template <int Rows, int Cols>
+float BasicBeamSearchBot<Rows, Cols>::expected(Worker& worker) {
+    game_type& game = worker.game;
+    float sum = 0;
+    for (int f = 1; f <= FIGURE_COUNT; ++f) {
+        const figure_shape* figure = &FigureTable::find_shape(f);
+        int found = worker.finder.find(game.get_rows(), figure, 0, 0, SPAWN_COL_OF(field_cols));
+        if (!found) {
+            return LOST_VALUE;
+        }
+        float best = LOST_VALUE;
+        for (int p = 0; p < found; ++p) {
+            game.apply(worker.finder.get(p), figure);
+            float value = config.weights.lines * (game.get_score() - root_score) + evaluate(game.get_features(), config.weights);
+            game.undo();
+            best = std::max(best, value);
+        }
+        sum += best;
+    }
+    return sum / FIGURE_COUNT;
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::keep(Worker& worker, int level, const Node& child) {
+    //boards of a level have the same lines, so the copies of a board tie and the first found wins
+    uint64_t key = Zobrist::mix(child.hash ^ (searches * BOT_MAX_DEPTH + level) * 0x9e3779b97f4a7c15ULL);
+    tt_entry seen;
+    if (table.probe(key, seen) && (uint32_t) seen.value < child.order) {
+        return;
+    }
+    tt_entry entry;
+    entry.value = (int32_t) child.order;
+    entry.depth = (int8_t) level;
+    entry.move = 0;
+    table.store(key, entry);
+
+    //the table may lose a race or an entry, the worker's own boards are checked too
+    std::vector<Node>& kept = worker.kept;
+    if ((int) kept.size() == config.width && !better(child, kept.front())) {
+        return;
+    }
+    for (auto & k : kept) {
+        if (k.hash == child.hash) {
+            if (better(child, k)) {
+                k = child;
+                std::make_heap(kept.begin(), kept.end(), better);
+            }
+            return;
+        }
+    }
+    if ((int) kept.size() < config.width) {
+        kept.push_back(child);
+        std::push_heap(kept.begin(), kept.end(), better);
+    } else {
+        std::pop_heap(kept.begin(), kept.end(), better);
+        kept.back() = child;
+        std::push_heap(kept.begin(), kept.end(), better);
+    }
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::select(int width) {
+    std::sort(next.begin(), next.end(), better);
+    beam.clear();
+    for (size_t k = 0; k < next.size() && (int) beam.size() < width; ++k) {
+        bool copy = false;
+        for (size_t b = 0; b < beam.size() && !copy; ++b) {
+            copy = beam[b].hash == next[k].hash;
+        }
+        if (!copy) {
+            beam.push_back(next[k]);
+        }
+    }
+}
+
+template <int Rows, int Cols>
+bool BasicBeamSearchBot<Rows, Cols>::is_expired(long long deadline) {
+    if (expired.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (deadline && now() >= deadline) {
+        expired = true;
+        return true;
+    }
+    return false;
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::settle(Worker& worker, int level, Node& child) {
+    game_type& game = worker.game;
+    game.apply(child.path[level], figures[level]);
+    child.hash = game.get_board_hash();
+    child.lines = game.get_score() - root_score;
+    child.value = config.weights.lines * child.lines + evaluate(game.get_features(), config.weights);
+    game.undo();
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::walk(Worker& worker, const Node& node, int levels) {
+    for (int level = 0; level < levels; ++level) {
+        worker.game.apply(node.path[level], figures[level]);
+    }
+}
+
+template <int Rows, int Cols>
+void BasicBeamSearchBot<Rows, Cols>::unwalk(Worker& worker, int levels) {
+    for (int level = 0; level < levels; ++level) {
+        worker.game.undo();
+    }
+}
+
+template <int Rows, int Cols>
+float BasicBeamSearchBot<Rows, Cols>::evaluate(const typename game_type::features_type& features, const BotWeights& weights) {
+    return weights.height * features.aggregate_height + weights.holes * features.holes
+            + weights.bumpiness * features.bumpiness();
+}
+
+template <int Rows, int Cols>
+bool BasicBeamSearchBot<Rows, Cols>::better(const Node& a, const Node& b) {
+    return a.value > b.value || (a.value == b.value && a.order < b.order);
+}
+
+template <int Rows, int Cols>
+long long BasicBeamSearchBot<Rows, Cols>::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//the wells BasicTetrisGame is instantiated for
+template class BasicBeamSearchBot<GAME_FIELD_ROWS, GAME_FIELD_COLS>;
+template class BasicBeamSearchBot<GAME_FIELD_ROWS, 18>;
+template class BasicBeamSearchBot<GAME_FIELD_ROWS, 42>;
+template class BasicBeamSearchBot<42, GAME_FIELD_COLS>;
+template class BasicBeamSearchBot<DYNAMIC_SIZE, DYNAMIC_SIZE>;
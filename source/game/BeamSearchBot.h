@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include "TetrisGame.h"
+#include "PlacementFinder.h"
+#include "ThreadPool.h"
+#include "TranspositionTable.h"
+
+//deepest search, levels of known figures plus the one scoring unknown figures
+#define BOT_MAX_DEPTH 8
+
+//weights of the board features, a board scores the weighted sum
+struct BotWeights {
+    float height;
+    float lines;
+    float holes;
+    float bumpiness;
+
+    BotWeights();
+};
+
+struct BotConfig {
+    //boards kept after every level
+    int width;
+    //placements looked ahead, the current figure included, at most BOT_MAX_DEPTH
+    int depth;
+    //0 means one per hardware thread
+    int threads;
+    //search time limit in milliseconds, 0 means no limit
+    int budget;
+    //megabytes of the transposition table the workers share
+    int table;
+    BotWeights weights;
+
+    BotConfig();
+};
+
+template <int Rows, int Cols>
+struct basic_bot_move {
+    placement target;
+    //inputs moving the falling figure to target, see BasicPlacementFinder::inputs
+    uint8_t inputs[BasicPlacementFinder<Rows, Cols>::states];
+    int length;
+    float value;
+    //levels searched before the budget ran out
+    int levels;
+};
+
+typedef basic_bot_move<GAME_FIELD_ROWS, GAME_FIELD_COLS> BotMove;
+
+/*
+ Plays a BasicTetrisGame by beam search over placements.
+
+ Level 0 enumerates the placements of the falling figure, every next level
+ places the following figure on each of the `width` best boards of the
+ previous one. The figures after the falling one come from `preview`; once
+ they run out the next level scores a board by the mean of the best
+ placement of every figure, since any of them can come. Deeper levels
+ are not searched.
+
+ Every worker of the pool expands its own share of the beam on its own copy
+ of the game, set to the position once per think(). A node is only the
+ placements leading to it: the worker walks down to the node with apply()
+ and back with undo(), so boards are never copied and the features and
+ the hash of a child are the game's incremental ones.
+
+ A board reached more than once on a level, from other roots or by other
+ move orders, is kept and expanded once. Children are looked up by the
+ Zobrist hash of their board in a TranspositionTable the workers share,
+ and the beam is deduplicated by hash again when the workers' boards are
+ merged. Ties are broken by the order placements were found in, so the
+ chosen move does not depend on the number of threads.
+
+ The bot plays games of one BasicTetrisGame type, dynamic dimensions are
+ given to the constructor like to the game.
+ */
+template <int Rows, int Cols>
+class BasicBeamSearchBot {
+public:
+    typedef BasicTetrisGame<Rows, Cols> game_type;
+    typedef typename game_type::row_type row_type;
+    typedef BasicPlacementFinder<Rows, Cols> finder_type;
+    typedef basic_bot_move<Rows, Cols> move_type;
+
+    BasicBeamSearchBot(const BotConfig& config = BotConfig(), int rows = Rows, int cols = Cols);
+    virtual ~BasicBeamSearchBot();
+
+    //false when the falling figure can not be placed anywhere
+    virtual bool think(const game_type& game, move_type& move, const figure_shape* const* preview = 0, int previews = 0);
+
+    //weighted features of the locked cells, higher is better
+    static float evaluate(const typename game_type::features_type& features, const BotWeights& weights);
+
+private:
+
+    struct Node {
+        //placement of the figure of every level down to the node
+        placement path[BOT_MAX_DEPTH];
+        //get_board_hash() of the board
+        uint64_t hash;
+        float value;
+        int lines;
+        //index of the level 0 placement the board descends from
+        int root;
+        //position among the candidates of its level, breaks ties
+        uint32_t order;
+    };
+
+    //best `width` children found by one worker, worst on top of the heap
+    struct Worker {
+        finder_type finder;
+        //deals figures of its own, the search places those of `figures` instead
+        game_type game;
+        std::vector<Node> kept;
+
+        Worker(int rows, int cols) : finder(rows, cols), game(PieceQueue(), rows, cols) {
+        }
+    };
+
+    BotConfig config;
+    int field_rows;
+    int field_cols;
+    //search states of the well, which bounds the placements of a figure
+    int states;
+    ThreadPool pool;
+    finder_type root_finder;
+    TranspositionTable table;
+    //think() calls so far, keys of older calls never match
+    uint64_t searches;
+    //the figure placed on every level, null when it is not known
+    const figure_shape* figures[BOT_MAX_DEPTH];
+    //score of the position searched
+    int root_score;
+    std::vector<Worker> workers;
+    std::vector<Node> beam;
+    std::vector<Node> next;
+    std::atomic<bool> expired;
+
+    void expand(const Node& parent, int index, int level, Worker& worker);
+    float expected(Worker& worker);
+    void keep(Worker& worker, int level, const Node& child);
+    //keeps the `width` best boards of next in the beam, each board once
+    void select(int width);
+    bool is_expired(long long deadline);
+    //places figures[level] at child.path[level] on the worker's game and scores the board
+    void settle(Worker& worker, int level, Node& child);
+    //plays the `levels` first placements of the node on the worker's game, or takes them back
+    void walk(Worker& worker, const Node& node, int levels);
+    void unwalk(Worker& worker, int levels);
+
+    static bool better(const Node& a, const Node& b);
+    static long long now();
+
+    //copying disabled
+    BasicBeamSearchBot(const BasicBeamSearchBot&);
+    const BasicBeamSearchBot& operator=(const BasicBeamSearchBot&);
+};
+
+typedef BasicBeamSearchBot<GAME_FIELD_ROWS, GAME_FIELD_COLS> BeamSearchBot;
@@ -0,0 +1,54 @@
+#include <assert.h>
+
+#include "EventBus.h"
+
+EventRing::EventRing(int capacity) {
+    assert(capacity > 0);
+    uint64_t size = 1;
+    while (size < (uint64_t) capacity) {
+        size *= 2;
+    }
+    this->head = 0;
+    this->dropped = 0;
+    this->max_lag = 0;
+    this->tail = 0;
+    this->mask = size - 1;
+    this->slots.resize(size);
+}
+
+EventRing::~EventRing() {
+}
+
+int EventRing::capacity() const {
+    return (int) (mask + 1);
+}
+
+uint64_t EventRing::lag() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+subscriber_stats EventRing::stats() const {
+    subscriber_stats s;
+    s.delivered = head.load(std::memory_order_relaxed);
+    s.dropped = dropped.load(std::memory_order_relaxed);
+    s.max_lag = max_lag.load(std::memory_order_relaxed);
+    return s;
+}
+
+EventBus::EventBus() {
+}
+
+EventBus::~EventBus() {
+    for (size_t k = 0; k < rings.size(); ++k) {
+        delete rings[k];
+    }
+}
+
+EventRing* EventBus::subscribe(int capacity) {
+    rings.push_back(new EventRing(capacity));
+    return rings.back();
+}
+
+int EventBus::subscribers() const {
+    return (int) rings.size();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+//events a subscriber can hold before new ones are dropped
+#define EVENT_RING_SIZE 256
+
+enum GameEventType {
+    EVENT_SPAWNED,
+    EVENT_LOCKED,
+    EVENT_CLEARED,
+    EVENT_GAME_OVER
+};
+
+struct game_event {
+    uint8_t type;
+    //FigureTable id, rotation and position of the figure spawned or locked
+    int8_t figure;
+    int8_t rotation;
+    int8_t row;
+    int8_t col;
+    //score after the event
+    int score;
+    //rows cleared, bit i for row i before the clear
+    uint64_t rows;
+};
+
+struct subscriber_stats {
+    uint64_t delivered;
+    uint64_t dropped;
+    //most events ever waiting for the subscriber
+    uint64_t max_lag;
+};
+
+/*
+ Bounded queue of events from one producer to one consumer, without locks.
+
+ The producer never waits for the consumer: an event that finds the ring
+ full is dropped and counted, so a slow subscriber loses events instead of
+ holding up the game.
+ */
+class EventRing {
+public:
+    explicit EventRing(int capacity = EVENT_RING_SIZE);
+    virtual ~EventRing();
+
+    //producer side, false when the event was dropped
+    bool push(const game_event& e) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t lag = h - tail.load(std::memory_order_acquire);
+        if (lag > mask) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & mask] = e;
+        head.store(h + 1, std::memory_order_release);
+        if (lag + 1 > max_lag.load(std::memory_order_relaxed)) {
+            max_lag.store(lag + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    //consumer side, false when there is nothing to take
+    bool pop(game_event& e) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        e = slots[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    int capacity() const;
+    //events waiting for the consumer
+    uint64_t lag() const;
+    subscriber_stats stats() const;
+
+private:
+    //written by the producer only
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> max_lag;
+    char producer_padding[40];
+    //written by the consumer only
+    std::atomic<uint64_t> tail;
+    char consumer_padding[56];
+    uint64_t mask;
+    std::vector<game_event> slots;
+
+    //copying disabled
+    EventRing(const EventRing&);
+    const EventRing& operator=(const EventRing&);
+};
+
+/*
+ Typed events of a game delivered to every subscriber through its own
+ EventRing, see BasicTetrisGame::set_events.
+
+ Subscribing is not thread safe and has to happen before the game starts
+ publishing. From then on the publishing thread and every subscriber's
+ thread only touch their own end of each ring.
+ */
+class EventBus {
+public:
+    EventBus();
+    virtual ~EventBus();
+
+    //the ring belongs to the bus
+    EventRing* subscribe(int capacity = EVENT_RING_SIZE);
+    int subscribers() const;
+
+    void publish(const game_event& e) {
+        for (size_t k = 0; k < rings.size(); ++k) {
+            rings[k]->push(e);
+        }
+    }
+
+private:
+    std::vector<EventRing*> rings;
+
+    //copying disabled
+    EventBus(const EventBus&);
+    const EventBus& operator=(const EventBus&);
+};
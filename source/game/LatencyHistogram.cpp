@@ -0,0 +1,61 @@
+#include <assert.h>
+
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram(double resolution, double range) {
+    assert(resolution > 0 && range >= resolution);
+    this->resolution = resolution;
+    this->buckets.resize((size_t) (range / resolution + 0.5));
+    clear();
+}
+
+LatencyHistogram::~LatencyHistogram() {
+}
+
+void LatencyHistogram::record(double seconds) {
+    if (seconds < 0) {
+        seconds = 0;
+    }
+    size_t k = (size_t) (seconds / resolution);
+    ++buckets[k < buckets.size() ? k : buckets.size() - 1];
+    ++samples;
+    if (seconds > largest) {
+        largest = seconds;
+    }
+}
+
+void LatencyHistogram::clear() {
+    for (size_t k = 0; k < buckets.size(); ++k) {
+        buckets[k] = 0;
+    }
+    samples = 0;
+    largest = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return samples;
+}
+
+double LatencyHistogram::max() const {
+    return largest;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (!samples) {
+        return 0;
+    }
+    //the sample of rank ceil(p * samples), at least the first
+    uint64_t rank = (uint64_t) (p * samples);
+    if (rank < p * samples || rank == 0) {
+        ++rank;
+    }
+    uint64_t seen = 0;
+    for (size_t k = 0; k < buckets.size(); ++k) {
+        seen += buckets[k];
+        if (seen >= rank && k + 1 < buckets.size()) {
+            double top = (k + 1) * resolution;
+            return top < largest ? top : largest;
+        }
+    }
+    return largest;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Counts latencies in buckets of equal width, for the percentiles of a
+ long run without keeping every sample. Samples past the last bucket
+ count in it, the largest sample is kept exactly.
+ */
+class LatencyHistogram {
+public:
+    //buckets `resolution` seconds wide up to `range` seconds
+    LatencyHistogram(double resolution = 0.00025, double range = 0.25);
+    virtual ~LatencyHistogram();
+
+    void record(double seconds);
+    void clear();
+
+    uint64_t count() const;
+    double max() const;
+    //seconds that fraction `p` of the samples do not exceed, rounded up to the bucket
+    double percentile(double p) const;
+
+private:
+    double resolution;
+    std::vector<uint64_t> buckets;
+    uint64_t samples;
+    double largest;
+};
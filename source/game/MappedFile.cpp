@@ -0,0 +1,60 @@
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const char* path) {
+    opened = false;
+    mapping = 0;
+    length = 0;
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* p = mmap(0, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            mapping = p;
+            length = (size_t) info.st_size;
+            opened = true;
+        }
+    }
+    ::close(fd);
+    if (opened) {
+        return;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        length = buffer.size();
+        opened = true;
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapping) {
+        munmap(mapping, length);
+    }
+}
+
+bool MappedFile::is_open() const {
+    return opened;
+}
+
+const uint8_t* MappedFile::data() const {
+    if (mapping) {
+        return (const uint8_t*) mapping;
+    }
+    return buffer.empty() ? 0 : &buffer[0];
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Read only view of a whole file.
+
+ The file is mapped into memory, so scanning thousands of them costs no
+ copies and pages are only read when touched. Where mapping fails the file
+ is read into a buffer instead.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const char* path);
+    virtual ~MappedFile();
+
+    bool is_open() const;
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    bool opened;
+    //null unless the file is mapped
+    void* mapping;
+    size_t length;
+    std::vector<uint8_t> buffer;
+};
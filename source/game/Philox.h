@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+struct philox_block {
+    uint32_t words[4];
+};
+
+/*
+ Philox4x32-10 counter based generator (Salmon et al., "Parallel random
+ numbers: as easy as 1, 2, 3").
+
+ Every 128 bit counter maps to four random words under a 64 bit key, with
+ no state in between. Any draw of any stream costs the same ten rounds,
+ no matter how many draws come before it.
+ */
+namespace Philox {
+
+    inline uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t& hi) {
+        uint64_t product = (uint64_t) a * b;
+        hi = (uint32_t) (product >> 32);
+        return (uint32_t) product;
+    }
+
+    inline philox_block generate(uint64_t counter_lo, uint64_t counter_hi, uint64_t key) {
+        uint32_t c0 = (uint32_t) counter_lo;
+        uint32_t c1 = (uint32_t) (counter_lo >> 32);
+        uint32_t c2 = (uint32_t) counter_hi;
+        uint32_t c3 = (uint32_t) (counter_hi >> 32);
+        uint32_t k0 = (uint32_t) key;
+        uint32_t k1 = (uint32_t) (key >> 32);
+        for (int round = 0; round < 10; ++round) {
+            uint32_t hi0;
+            uint32_t hi1;
+            uint32_t lo0 = mulhilo(0xD2511F53, c0, hi0);
+            uint32_t lo1 = mulhilo(0xCD9E8D57, c2, hi1);
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        philox_block block = {{c0, c1, c2, c3}};
+        return block;
+    }
+
+    //uniform in [0, bound)
+    inline uint32_t below(uint32_t word, uint32_t bound) {
+        return (uint32_t) (((uint64_t) word * bound) >> 32);
+    }
+
+    //uniform in [0, limit)
+    inline float unit(uint32_t word, float limit) {
+        return (float) (word >> 8) * (1.0f / 16777216.0f) * limit;
+    }
+}
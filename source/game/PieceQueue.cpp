@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "PieceQueue.h"
+
+//random words per piece, one for the tint and one for the figure or the shuffle
+#define PIECE_WORDS 2
+
+PieceQueue::PieceQueue(uint64_t seed, uint64_t game, int bag, int preview) {
+    assert(bag >= 0 && bag <= MAX_BAG_COPIES);
+    assert(preview >= 1 && preview <= MAX_PREVIEW);
+    static_assert(MAX_PREVIEW + FIGURE_COUNT * MAX_BAG_COPIES <= PIECE_QUEUE_SIZE, "a block may not fit in the ring");
+    static_assert(FREE_BLOCK_SIZE <= FIGURE_COUNT * MAX_BAG_COPIES, "a block may not fit in the ring");
+    this->seed = seed;
+    this->game = game;
+    this->bag = bag;
+    this->preview = preview;
+    this->head = 0;
+    this->tail = 0;
+    this->first = 0;
+    refill();
+}
+
+int PieceQueue::preview_size() const {
+    return preview;
+}
+
+uint64_t PieceQueue::position() const {
+    return head;
+}
+
+void PieceQueue::rewind(uint64_t position) {
+    if (position < first || position > tail) {
+        tail = position - position % block_size(bag);
+        first = tail;
+    }
+    head = position;
+    refill();
+}
+
+queued_piece PieceQueue::at(uint64_t position) const {
+    return piece_at(seed, game, bag, position);
+}
+
+queued_piece PieceQueue::piece_at(uint64_t seed, uint64_t game, int bag, uint64_t position) {
+    int size = block_size(bag);
+    uint64_t block = position / size;
+    int k = (int) (position % size);
+    if (!bag) {
+        queued_piece p;
+        p.figure = (uint8_t) (1 + Philox::below(word(seed, game, block, k * PIECE_WORDS + 1), FIGURE_COUNT));
+        p.tint = Philox::unit(word(seed, game, block, k * PIECE_WORDS), 9.0f);
+        return p;
+    }
+    queued_piece pieces[FIGURE_COUNT * MAX_BAG_COPIES];
+    make_block(seed, game, bag, block, pieces);
+    return pieces[k];
+}
+
+int PieceQueue::block_size(int bag) {
+    return bag ? FIGURE_COUNT * bag : FREE_BLOCK_SIZE;
+}
+
+void PieceQueue::refill() {
+    queued_piece pieces[FIGURE_COUNT * MAX_BAG_COPIES];
+    int size = block_size(bag);
+    while (tail < head + preview) {
+        make_block(seed, game, bag, tail / size, pieces);
+        for (int k = 0; k < size; ++k) {
+            ring[(tail + k) & (PIECE_QUEUE_SIZE - 1)] = pieces[k];
+        }
+        tail += size;
+        if (tail - first > PIECE_QUEUE_SIZE) {
+            first = tail - PIECE_QUEUE_SIZE;
+        }
+    }
+}
+
+uint32_t PieceQueue::word(uint64_t seed, uint64_t game, uint64_t block, int n) {
+    //a block takes at most 16 counters, 64 words
+    return Philox::generate(block << 4 | n >> 2, game, seed).words[n & 3];
+}
+
+void PieceQueue::make_block(uint64_t seed, uint64_t game, int bag, uint64_t block, queued_piece* out) {
+    static_assert(FIGURE_COUNT * MAX_BAG_COPIES * PIECE_WORDS <= 64, "a block takes more than 16 counters");
+    int size = block_size(bag);
+    uint32_t words[FIGURE_COUNT * MAX_BAG_COPIES * PIECE_WORDS];
+    for (int n = 0; n < size * PIECE_WORDS; n += 4) {
+        philox_block b = Philox::generate(block << 4 | n >> 2, game, seed);
+        std::copy(b.words, b.words + 4, words + n);
+    }
+    for (int k = 0; k < size; ++k) {
+        out[k].figure = (uint8_t) (bag ? 1 + k % FIGURE_COUNT : 1 + Philox::below(words[k * PIECE_WORDS + 1], FIGURE_COUNT));
+        out[k].tint = Philox::unit(words[k * PIECE_WORDS], 9.0f);
+    }
+    if (bag) {
+        //Fisher-Yates over the figures, tints stay in draw order
+        for (int k = size - 1; k > 0; --k) {
+            int other = (int) Philox::below(words[k * PIECE_WORDS + 1], k + 1);
+            std::swap(out[k].figure, out[other].figure);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include "Philox.h"
+#include "figures/FigureTable.h"
+
+#define PIECE_QUEUE_SIZE 64
+#define MAX_PREVIEW 16
+//a bag holds this many copies of every figure at most
+#define MAX_BAG_COPIES 6
+//pieces drawn per block when every piece is drawn on its own
+#define FREE_BLOCK_SIZE 16
+
+struct queued_piece {
+    //figure id, see FigureTable
+    uint8_t figure;
+    //w component of the piece colour, the block texture
+    float tint;
+};
+
+/*
+ Upcoming pieces of one game, with a preview of the next ones.
+
+ Pieces are made in blocks. With a bag, a block is `bag` copies of every
+ figure in shuffled order, so no figure waits longer than two bags.
+ Without one, it is FREE_BLOCK_SIZE figures drawn independently.
+
+ The random words of block b of game g are Philox draws at counter (b, g)
+ under the seed as key, so the pieces of a game depend on (seed, game)
+ only: not on the thread or machine it runs on, nor on what ran before.
+ piece_at() computes any piece of any game directly, and a position is
+ all it takes to rewind a queue.
+
+ Taking a piece is inlined and never virtual. Blocks are only made when
+ the preview runs short.
+ */
+class PieceQueue {
+public:
+    explicit PieceQueue(uint64_t seed = 1, uint64_t game = 0, int bag = 1, int preview = 5);
+
+    //takes the next piece
+    const queued_piece& next() {
+        const queued_piece& p = ring[head++ & (PIECE_QUEUE_SIZE - 1)];
+        if (tail < head + preview) {
+            refill();
+        }
+        return p;
+    }
+
+    //the piece after the next `k` ones, k below preview_size()
+    const queued_piece& peek(int k) const {
+        assert(k >= 0 && k < preview);
+        return ring[(head + k) & (PIECE_QUEUE_SIZE - 1)];
+    }
+
+    int preview_size() const;
+    //pieces taken so far
+    uint64_t position() const;
+    //makes the queue continue from an earlier or later position
+    void rewind(uint64_t position);
+    //piece `position` of this game, taken or not
+    queued_piece at(uint64_t position) const;
+
+    //piece `position` of game `game`, the same a queue deals at that position
+    static queued_piece piece_at(uint64_t seed, uint64_t game, int bag, uint64_t position);
+
+private:
+    uint64_t seed;
+    uint64_t game;
+    int bag;
+    int preview;
+    uint64_t head;
+    uint64_t tail;
+    //oldest piece still in the ring
+    uint64_t first;
+    queued_piece ring[PIECE_QUEUE_SIZE];
+
+    void refill();
+
+    static int block_size(int bag);
+    static uint32_t word(uint64_t seed, uint64_t game, uint64_t block, int n);
+    static void make_block(uint64_t seed, uint64_t game, int bag, uint64_t block, queued_piece* out);
+};
@@ -0,0 +1,159 @@
+#include <cstring>
+
+#include "PlacementFinder.h"
+
+template <class Row>
+static bool collides(const Row* rows, const geometry_mask& geo, int i, int j) {
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (rows[i + r] & (Row) ((uint64_t) geo.rows[r] << j)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool same_cells(const geometry_mask& a, const geometry_mask& b) {
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        row_mask ra = a.top + r < GEOMETRY_SIZE ? a.rows[a.top + r] >> a.left : 0;
+        row_mask rb = b.top + r < GEOMETRY_SIZE ? b.rows[b.top + r] >> b.left : 0;
+        if (ra != rb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int Rows, int Cols>
+BasicPlacementFinder<Rows, Cols>::BasicPlacementFinder(int rows, int cols) {
+    assert(rows > 0 && cols > 0 && (Rows == DYNAMIC_SIZE || rows == Rows) && (Cols == DYNAMIC_SIZE || cols == Cols));
+    assert(rows <= traits::rows_capacity && cols <= traits::cols_capacity);
+    field_rows = rows;
+    field_cols = cols;
+    count = 0;
+    start = 0;
+    epoch = 0;
+    std::memset(visited, 0, sizeof (visited));
+    std::memset(taken, 0, sizeof (taken));
+}
+
+template <int Rows, int Cols>
+BasicPlacementFinder<Rows, Cols>::~BasicPlacementFinder() {
+}
+
+template <int Rows, int Cols>
+int BasicPlacementFinder<Rows, Cols>::find(const game_type& game) {
+    field_rows = game.get_field_rows();
+    field_cols = game.get_field_cols();
+    return find(game.get_rows(), game.get_figure(), game.get_rotation(), game.get_row(), game.get_col());
+}
+
+template <int Rows, int Cols>
+int BasicPlacementFinder<Rows, Cols>::find(const row_type* rows, const figure_shape* figure, int rotation, int i, int j) {
+    count = 0;
+    if (!figure || collides(rows, figure->rotations[rotation], i, j)) {
+        return 0;
+    }
+    epoch++;
+
+    //rotations covering the same cells share the lowest of their indexes
+    int canonical[MAX_ROTATION_INDEX + 1];
+    for (int t = 0; t <= MAX_ROTATION_INDEX; ++t) {
+        canonical[t] = t;
+        for (int u = 0; u < t; ++u) {
+            if (same_cells(figure->rotations[t], figure->rotations[u])) {
+                canonical[t] = canonical[u];
+                break;
+            }
+        }
+    }
+
+    int head = 0;
+    int tail = 0;
+    start = state(rotation, i, j);
+    visited[start] = epoch;
+    queue[tail++] = (uint16_t) start;
+    while (head < tail) {
+        int s = queue[head++];
+        int t = s / (height() * width());
+        i = s / width() % height();
+        j = s % width();
+        const geometry_mask& geo = figure->rotations[t];
+
+        //same bound rules as TetrisGame::move
+        bool above_floor = i + geo.height < height() - 1;
+        int next[4] = {-1, -1, -1, -1};
+        int n = t == MAX_ROTATION_INDEX ? 0 : t + 1;
+        if (j > 0 && above_floor && j + geo.right < width() && !collides(rows, figure->rotations[n], i, j)) {
+            next[INPUT_ROTATE] = state(n, i, j);
+        }
+        if (j > 0 && !collides(rows, geo, i, j - 1)) {
+            next[INPUT_LEFT] = state(t, i, j - 1);
+        }
+        if (j + geo.right + 1 < width() && !collides(rows, geo, i, j + 1)) {
+            next[INPUT_RIGHT] = state(t, i, j + 1);
+        }
+        if (above_floor && !collides(rows, geo, i + 1, j)) {
+            next[INPUT_DOWN] = state(t, i + 1, j);
+        } else {
+            int key = state(canonical[t], i + geo.top, j + geo.left);
+            if (taken[key] != epoch) {
+                taken[key] = epoch;
+                placement& p = found[count++];
+                p.rotation = (int8_t) t;
+                p.row = (int8_t) i;
+                p.col = (int8_t) j;
+                p.state = (uint16_t) s;
+            }
+        }
+        for (int k = 0; k < 4; ++k) {
+            if (next[k] >= 0 && visited[next[k]] != epoch) {
+                visited[next[k]] = epoch;
+                parent[next[k]] = (uint16_t) s;
+                via[next[k]] = (uint8_t) k;
+                queue[tail++] = (uint16_t) next[k];
+            }
+        }
+    }
+    return count;
+}
+
+template <int Rows, int Cols>
+int BasicPlacementFinder<Rows, Cols>::size() const {
+    return count;
+}
+
+template <int Rows, int Cols>
+const placement& BasicPlacementFinder<Rows, Cols>::get(int index) const {
+    assert(index >= 0 && index < count);
+    return found[index];
+}
+
+template <int Rows, int Cols>
+int BasicPlacementFinder<Rows, Cols>::inputs(int index, uint8_t* out, int capacity) const {
+    int length = 0;
+    for (int s = get(index).state; s != start; s = parent[s]) {
+        length++;
+    }
+    //falling at the end is a single drop
+    int s = get(index).state;
+    while (s != start && via[s] == INPUT_DOWN) {
+        s = parent[s];
+        length--;
+    }
+    if (length + 1 > capacity) {
+        return -1;
+    }
+    out[length] = INPUT_DROP;
+    for (int k = length - 1; k >= 0; --k) {
+        out[k] = via[s];
+        s = parent[s];
+    }
+    return length + 1;
+}
+
+//the wells BasicTetrisGame is instantiated for
+template class BasicPlacementFinder<GAME_FIELD_ROWS, GAME_FIELD_COLS>;
+template class BasicPlacementFinder<GAME_FIELD_ROWS, 18>;
+template class BasicPlacementFinder<GAME_FIELD_ROWS, 42>;
+template class BasicPlacementFinder<42, GAME_FIELD_COLS>;
+template class BasicPlacementFinder<DYNAMIC_SIZE, DYNAMIC_SIZE>;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include "TetrisGame.h"
+
+#define PLACEMENT_STATES ((MAX_ROTATION_INDEX + 1) * GAME_FIELD_ROWS * GAME_FIELD_COLS)
+
+/*
+ Enumerates every distinct place the falling figure can be locked at.
+
+ The search walks (rotation, row, column) states with the same rules as
+ TetrisGame::move, straight on the row masks, and keeps the states the figure
+ can not fall out of. Placements covering the same cells, like the
+ rotations of the square, are reported once. All the storage is inside the
+ finder so a search never allocates, keep one finder per thread and reuse it.
+
+ The finder searches wells of one BasicTetrisGame type. Dynamic dimensions
+ are given to the constructor like to the game, or taken from the game by
+ find(game).
+ */
+template <int Rows, int Cols>
+class BasicPlacementFinder {
+public:
+    typedef BasicTetrisGame<Rows, Cols> game_type;
+    typedef typename game_type::row_type row_type;
+
+    //states of the biggest well of the type, which also bounds the inputs to a placement
+    static const int states = (MAX_ROTATION_INDEX + 1) * well_traits<Rows, Cols>::rows_capacity * well_traits<Rows, Cols>::cols_capacity;
+
+    BasicPlacementFinder(int rows = Rows, int cols = Cols);
+    virtual ~BasicPlacementFinder();
+
+    int find(const game_type& game);
+    int find(const row_type* rows, const figure_shape* figure, int rotation, int i, int j);
+
+    int size() const;
+    const placement& get(int index) const;
+
+    /*
+     Writes the shortest input sequence reaching the placement from the
+     position the search started at, ending with INPUT_DROP.
+
+     @result the number of inputs, or -1 when they do not fit in `capacity`
+     */
+    int inputs(int index, uint8_t* out, int capacity) const;
+
+private:
+    typedef well_traits<Rows, Cols> traits;
+
+    int field_rows;
+    int field_cols;
+    placement found[states];
+    int count;
+    int start;
+    //a state is visited when its stamp equals epoch, so nothing is cleared between searches
+    uint32_t epoch;
+    uint32_t visited[states];
+    uint32_t taken[states];
+    uint16_t parent[states];
+    uint8_t via[states];
+    uint16_t queue[states];
+
+    //the template dimensions when they are given, so that loops over them unroll
+    int height() const {
+        return Rows != DYNAMIC_SIZE ? Rows : field_rows;
+    }
+
+    int width() const {
+        return Cols != DYNAMIC_SIZE ? Cols : field_cols;
+    }
+
+    int state(int t, int i, int j) const {
+        return (t * height() + i) * width() + j;
+    }
+};
+
+typedef BasicPlacementFinder<GAME_FIELD_ROWS, GAME_FIELD_COLS> PlacementFinder;
@@ -6,3 +6,8 @@ RandomNumberProvider::RandomNumberProvider() {
 RandomNumberProvider::~RandomNumberProvider() {
 }
 
+void RandomNumberProvider::save(rng_state&) const {
+}
+
+void RandomNumberProvider::restore(const rng_state&) {
+}
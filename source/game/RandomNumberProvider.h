@@ -1,11 +1,21 @@
 #pragma once
 
+#include <stdint.h>
+
+//opaque snapshot of a generator, big enough for any provider to fit in
+struct rng_state {
+    uint64_t words[4];
+};
+
 class RandomNumberProvider {
 public:
     RandomNumberProvider();
     virtual ~RandomNumberProvider();
     virtual int next_int(int high_limit) = 0;
     virtual float next_float(float high_limit) = 0;
+    //rewinding is a no-op for stateless providers
+    virtual void save(rng_state& state) const;
+    virtual void restore(const rng_state& state);
 private:
 
 };
@@ -0,0 +1,558 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+#include "Replay.h"
+#include "MappedFile.h"
+
+//size of REPLAY_MAGIC, without the terminating zero
+#define REPLAY_MAGIC_SIZE 4
+//longest run of ticks between two inputs, so that its gamma code fits one read
+#define MAX_TICK_RUN ((1ull << 32) - 1)
+
+//inputs other than INPUT_DOWN as they are packed in the stream
+static const GameInput stream_inputs[] = {INPUT_ROTATE, INPUT_LEFT, INPUT_RIGHT, INPUT_DROP};
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t) value);
+}
+
+//false when the varint runs past `end` or does not fit in 64 bits
+static bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t b = *p++;
+        value |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void put_fixed(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back((uint8_t) (value >> 8 * i));
+    }
+}
+
+static uint64_t get_fixed(const uint8_t*& p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= (uint64_t) *p++ << 8 * i;
+    }
+    return value;
+}
+
+replay_header::replay_header(uint64_t seed, uint64_t game, int bag, int preview) {
+    this->engine_version = ENGINE_VERSION;
+    this->seed = seed;
+    this->game = game;
+    this->bag = bag;
+    this->preview = preview;
+    this->rows = GAME_FIELD_ROWS;
+    this->cols = GAME_FIELD_COLS;
+}
+
+PieceQueue replay_header::queue() const {
+    return PieceQueue(seed, game, bag, preview);
+}
+
+bit_sink::bit_sink(std::vector<uint8_t>* out) {
+    this->out = out;
+    this->bits = 0;
+    this->count = 0;
+}
+
+void bit_sink::put(uint64_t value, int length) {
+    assert(length <= 32);
+    bits |= value << count;
+    count += length;
+    while (count >= 8) {
+        out->push_back((uint8_t) bits);
+        bits >>= 8;
+        count -= 8;
+    }
+}
+
+void bit_sink::flush() {
+    if (count > 0) {
+        out->push_back((uint8_t) bits);
+        bits = 0;
+        count = 0;
+    }
+}
+
+uint64_t bit_sink::offset() const {
+    return out->size() * 8 + count;
+}
+
+bit_source::bit_source(const uint8_t* begin, const uint8_t* end) {
+    this->cursor = begin;
+    this->end = end;
+    this->bits = 0;
+    this->count = 0;
+    this->past_end = 0;
+}
+
+void bit_source::fill() {
+    while (count <= 56) {
+        if (cursor < end) {
+            bits |= (uint64_t) *cursor++ << count;
+        } else {
+            past_end += 8;
+        }
+        count += 8;
+    }
+}
+
+uint64_t bit_source::take(int length) {
+    if (count < length) {
+        fill();
+    }
+    uint64_t value = bits & ((1ull << length) - 1);
+    bits >>= length;
+    count -= length;
+    return value;
+}
+
+bool bit_source::overrun() const {
+    return past_end > count;
+}
+
+ReplayWriter::ReplayWriter(const replay_header& header, int keyframe_interval) :
+header(header),
+packer(&stream) {
+    this->keyframe_interval = keyframe_interval;
+    next_keyframe = keyframe_interval > 0 ? 0 : LLONG_MAX;
+    pending = 0;
+    input_count = 0;
+    tick_count = 0;
+    finished = false;
+}
+
+ReplayWriter::~ReplayWriter() {
+}
+
+void ReplayWriter::record(GameInput input) {
+    assert(!finished);
+    if (input == INPUT_DOWN) {
+        pending++;
+        tick_count++;
+        return;
+    }
+    assert(pending <= MAX_TICK_RUN);
+    int code = input == INPUT_DROP ? 3 : input;
+    packer.put((pending ? 1 : 0) | code << 1, 3);
+    if (pending) {
+        //elias gamma: as many zeros as the run has bits after the leading one, then the run
+        int length = 63 - __builtin_clzll(pending);
+        packer.put(0, length);
+        packer.put(1, 1);
+        packer.put(pending & ((1ull << length) - 1), length);
+        pending = 0;
+    }
+    input_count++;
+}
+
+void ReplayWriter::keyframe(const game_state& state) {
+    long long step = input_count + tick_count;
+    index.push_back(step);
+    index.push_back(frames.size());
+    next_keyframe = keyframe_interval > 0 ? step + keyframe_interval : LLONG_MAX;
+
+    put_varint(frames, step);
+    put_varint(frames, packer.offset());
+    put_varint(frames, input_count);
+    put_varint(frames, pending);
+    put_varint(frames, state.score);
+    put_varint(frames, state.position);
+    frames.push_back((uint8_t) state.figure);
+    frames.push_back((uint8_t) state.rotation);
+    frames.push_back((uint8_t) state.row);
+    frames.push_back((uint8_t) state.col);
+
+    uint64_t cells = ((1ull << (header.cols - 1)) - 1) & ~1ull;
+    int top = 0;
+    while (top < header.rows && !(state.rows[top] & cells)) {
+        top++;
+    }
+    put_varint(frames, top);
+    bit_sink board(&frames);
+    for (int i = top; i < header.rows; ++i) {
+        uint64_t row = (state.rows[i] & cells) >> 1;
+        for (int j = 0; j < header.cols - 2; j += 32) {
+            int length = std::min(32, header.cols - 2 - j);
+            board.put(row >> j & ((1ull << length) - 1), length);
+        }
+    }
+    board.flush();
+}
+
+void ReplayWriter::finish(uint64_t hash, int score) {
+    assert(!finished);
+    packer.flush();
+
+    bytes.assign(REPLAY_MAGIC, REPLAY_MAGIC + REPLAY_MAGIC_SIZE);
+    put_varint(bytes, REPLAY_FORMAT_VERSION);
+    put_varint(bytes, header.engine_version);
+    put_varint(bytes, header.seed);
+    put_varint(bytes, header.game);
+    put_varint(bytes, header.bag);
+    put_varint(bytes, header.preview);
+    put_varint(bytes, header.rows);
+    put_varint(bytes, header.cols);
+    put_varint(bytes, input_count);
+    put_varint(bytes, tick_count);
+    put_varint(bytes, score);
+    put_fixed(bytes, hash);
+    put_varint(bytes, stream.size());
+    bytes.insert(bytes.end(), stream.begin(), stream.end());
+
+    uint64_t frames_offset = bytes.size();
+    bytes.insert(bytes.end(), frames.begin(), frames.end());
+    uint64_t index_offset = bytes.size();
+    for (size_t k = 0; k < index.size(); k += 2) {
+        put_fixed(bytes, index[k]);
+        put_fixed(bytes, frames_offset + index[k + 1]);
+    }
+    put_fixed(bytes, index_offset);
+    put_fixed(bytes, index.size() / 2);
+    bytes.insert(bytes.end(), REPLAY_INDEX_MAGIC, REPLAY_INDEX_MAGIC + REPLAY_MAGIC_SIZE);
+    finished = true;
+}
+
+bool ReplayWriter::is_finished() const {
+    return finished;
+}
+
+const std::vector<uint8_t>& ReplayWriter::data() const {
+    return bytes;
+}
+
+bool ReplayWriter::save(const char* path) const {
+    assert(finished);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*) &bytes[0], bytes.size());
+    return (bool) out;
+}
+
+long long ReplayWriter::inputs() const {
+    return input_count;
+}
+
+long long ReplayWriter::ticks() const {
+    return tick_count;
+}
+
+int ReplayWriter::keyframes() const {
+    return index.size() / 2;
+}
+
+ReplayReader::ReplayReader(const uint8_t* data, size_t size) {
+    valid = false;
+    input_count = 0;
+    tick_count = 0;
+    final_score = 0;
+    final_hash = 0;
+    this->data = data;
+    stream = stream_end = index = 0;
+    keyframe_count = 0;
+    restart();
+
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    if (size < REPLAY_MAGIC_SIZE || std::memcmp(p, REPLAY_MAGIC, REPLAY_MAGIC_SIZE)) {
+        return;
+    }
+    p += REPLAY_MAGIC_SIZE;
+
+    uint64_t v[11];
+    for (int k = 0; k < 11; ++k) {
+        if (!get_varint(p, end, v[k])) {
+            return;
+        }
+    }
+    //version 1 replays end with the stream
+    if ((v[0] != 1 && v[0] != REPLAY_FORMAT_VERSION) || end - p < 8) {
+        return;
+    }
+    info.engine_version = (uint32_t) v[1];
+    info.seed = v[2];
+    info.game = v[3];
+    info.bag = (int) v[4];
+    info.preview = (int) v[5];
+    info.rows = (int) v[6];
+    info.cols = (int) v[7];
+    input_count = (long long) v[8];
+    tick_count = (long long) v[9];
+    final_score = (int) v[10];
+    final_hash = get_fixed(p);
+
+    uint64_t length;
+    if (!get_varint(p, end, length) || length > (uint64_t) (end - p)) {
+        return;
+    }
+    if (v[4] > MAX_BAG_COPIES || v[5] < 1 || v[5] > MAX_PREVIEW
+            || v[6] < 1 || v[6] > MAX_FIELD_ROWS || v[7] < GEOMETRY_SIZE || v[7] > MAX_FIELD_COLS
+            || v[8] > length * 8 / 3 || v[9] > (1ull << 62)) {
+        return;
+    }
+    stream = p;
+    stream_end = p + length;
+    if (v[0] != 1 && !read_index(end)) {
+        return;
+    }
+    valid = true;
+    restart();
+}
+
+bool ReplayReader::read_index(const uint8_t* end) {
+    //trailer: index offset, keyframe count and the magic
+    if (end - stream_end < 16 + REPLAY_MAGIC_SIZE
+            || std::memcmp(end - REPLAY_MAGIC_SIZE, REPLAY_INDEX_MAGIC, REPLAY_MAGIC_SIZE)) {
+        return false;
+    }
+    const uint8_t* p = end - REPLAY_MAGIC_SIZE - 16;
+    const uint8_t* trailer = p;
+    uint64_t offset = get_fixed(p);
+    uint64_t count = get_fixed(p);
+    if (offset < (uint64_t) (stream_end - data) || offset > (uint64_t) (trailer - data)
+            || count > (uint64_t) (trailer - data - offset) / 16) {
+        return false;
+    }
+    index = data + offset;
+    keyframe_count = (int) count;
+    //keyframes come in step order and lie between the stream and the index
+    long long last = -1;
+    for (int k = 0; k < keyframe_count; ++k) {
+        const uint8_t* entry = index + 16 * k;
+        uint64_t step = get_fixed(entry);
+        uint64_t at = get_fixed(entry);
+        if ((long long) step <= last || step > (uint64_t) (input_count + tick_count)
+                || at < (uint64_t) (stream_end - data) || at >= offset) {
+            return false;
+        }
+        last = (long long) step;
+    }
+    return true;
+}
+
+ReplayReader::~ReplayReader() {
+}
+
+bool ReplayReader::is_valid() const {
+    return valid;
+}
+
+const replay_header& ReplayReader::header() const {
+    return info;
+}
+
+long long ReplayReader::inputs() const {
+    return input_count;
+}
+
+long long ReplayReader::ticks() const {
+    return tick_count;
+}
+
+long long ReplayReader::steps() const {
+    return input_count + tick_count;
+}
+
+int ReplayReader::score() const {
+    return final_score;
+}
+
+uint64_t ReplayReader::hash() const {
+    return final_hash;
+}
+
+int ReplayReader::keyframes() const {
+    return keyframe_count;
+}
+
+long long ReplayReader::position() const {
+    return step;
+}
+
+void ReplayReader::restart() {
+    source = bit_source(stream, stream_end);
+    step = 0;
+    pending = 0;
+    waiting = -1;
+    skip = 0;
+    inputs_left = valid ? input_count : 0;
+    ticks_left = valid ? tick_count : 0;
+}
+
+bool ReplayReader::next_input(GameInput& input) {
+    if (inputs_left == 0) {
+        //ticks after the last input
+        if (ticks_left == 0) {
+            return false;
+        }
+        pending = ticks_left - 1;
+        ticks_left = 0;
+        step++;
+        input = INPUT_DOWN;
+        return true;
+    }
+    inputs_left--;
+
+    uint64_t code = source.take(3);
+    input = stream_inputs[code >> 1];
+    uint64_t run = 0;
+    if (code & 1) {
+        source.fill();
+        int length = source.bits ? __builtin_ctzll(source.bits) : 64;
+        if (length >= 32) {
+            return fail();
+        }
+        source.take(length + 1);
+        run = 1ull << length | source.take(length);
+    }
+    if (source.overrun() || run < skip || run - skip > (uint64_t) ticks_left) {
+        return fail();
+    }
+    run -= skip;
+    skip = 0;
+    ticks_left -= run;
+    step++;
+    if (run) {
+        pending = run - 1;
+        waiting = input;
+        input = INPUT_DOWN;
+    }
+    return true;
+}
+
+bool ReplayReader::fail() {
+    valid = false;
+    pending = 0;
+    waiting = -1;
+    inputs_left = 0;
+    ticks_left = 0;
+    return false;
+}
+
+int ReplayReader::find_keyframe(long long target) const {
+    int lo = 0;
+    int hi = keyframe_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const uint8_t* entry = index + 16 * mid;
+        if ((long long) get_fixed(entry) <= target) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+bool ReplayReader::load_keyframe(int k, game_state& state) {
+    const uint8_t* entry = index + 16 * k;
+    get_fixed(entry);
+    const uint8_t* p = data + get_fixed(entry);
+    const uint8_t* end = index;
+
+    uint64_t v[7];
+    for (int n = 0; n < 7; ++n) {
+        if (!get_varint(p, end, v[n]) || (n == 5 && end - p < 4)) {
+            return fail();
+        }
+        if (n == 5) {
+            state.figure = (int8_t) *p++;
+            state.rotation = (int8_t) *p++;
+            state.row = (int8_t) *p++;
+            state.col = (int8_t) *p++;
+        }
+    }
+    //step, bit offset, inputs before, ticks of the run played, score, position, empty rows on top
+    long long inputs_done = (long long) v[2];
+    long long ticks_done = (long long) v[0] - inputs_done;
+    if (v[1] > (uint64_t) (stream_end - stream) * 8 || inputs_done > input_count
+            || ticks_done < 0 || ticks_done > tick_count || v[3] > (uint64_t) ticks_done
+            || v[5] == 0 || v[6] > (uint64_t) info.rows
+            || state.figure < 0 || state.figure > FIGURE_COUNT
+            || state.rotation < 0 || state.rotation > MAX_ROTATION_INDEX) {
+        return fail();
+    }
+    state.score = (int) v[4];
+    state.position = v[5];
+
+    uint64_t cells = ((1ull << (info.cols - 1)) - 1) & ~1ull;
+    bit_source board(p, end);
+    for (int i = 0; i < info.rows; ++i) {
+        uint64_t row = 0;
+        if (i >= (int) v[6]) {
+            for (int j = 0; j < info.cols - 2; j += 32) {
+                int length = std::min(32, info.cols - 2 - j);
+                row |= board.take(length) << j;
+            }
+        }
+        state.rows[i] = ~cells | row << 1;
+    }
+    if (board.overrun()) {
+        return fail();
+    }
+
+    source = bit_source(stream + v[1] / 8, stream_end);
+    source.take(v[1] % 8);
+    step = (long long) v[0];
+    pending = 0;
+    waiting = -1;
+    skip = v[3];
+    inputs_left = input_count - inputs_done;
+    ticks_left = tick_count - ticks_done;
+    return true;
+}
+
+template <class Game>
+static void play_back(ReplayReader& reader, Game& game, replay_result& result) {
+    ReplayPlayer::play(reader, game);
+    result.valid = reader.is_valid();
+    result.score = game.get_score();
+    result.hash = game.get_hash();
+}
+
+replay_result ReplayPlayer::verify(const uint8_t* data, size_t size) {
+    replay_result result;
+    std::memset(&result, 0, sizeof (result));
+    ReplayReader reader(data, size);
+    const replay_header& header = reader.header();
+    if (!reader.is_valid() || header.engine_version != ENGINE_VERSION) {
+        return result;
+    }
+    if (header.rows == GAME_FIELD_ROWS && header.cols == GAME_FIELD_COLS) {
+        TetrisGame game(header.queue());
+        play_back(reader, game, result);
+    } else {
+        DynamicTetrisGame game(header.queue(), header.rows, header.cols);
+        play_back(reader, game, result);
+    }
+    result.inputs = reader.inputs();
+    result.ticks = reader.ticks();
+    result.verified = result.valid && result.hash == reader.hash() && result.score == reader.score();
+    return result;
+}
+
+replay_result ReplayPlayer::verify(const char* path) {
+    MappedFile file(path);
+    if (!file.is_open()) {
+        replay_result result;
+        std::memset(&result, 0, sizeof (result));
+        return result;
+    }
+    return verify(file.data(), file.size());
+}
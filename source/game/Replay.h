@@ -0,0 +1,321 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "TetrisGame.h"
+#include "PieceQueue.h"
+
+#define REPLAY_MAGIC "TRPL"
+#define REPLAY_INDEX_MAGIC "TRPI"
+#define REPLAY_FORMAT_VERSION 2
+//steps between keyframes, about 500 bot placements
+#define REPLAY_KEYFRAME_INTERVAL 2048
+
+//everything a game is made from, the inputs aside
+struct replay_header {
+    uint32_t engine_version;
+    uint64_t seed;
+    uint64_t game;
+    int bag;
+    int preview;
+    //well dimensions, border columns included
+    int rows;
+    int cols;
+
+    replay_header(uint64_t seed = 1, uint64_t game = 0, int bag = 1, int preview = 5);
+
+    //the queue the recorded game draws its pieces from
+    PieceQueue queue() const;
+};
+
+//outcome of playing a replay back
+struct replay_result {
+    //the replay could be parsed and was made by this engine version
+    bool valid;
+    //the game ended with the recorded hash and score
+    bool verified;
+    long long inputs;
+    long long ticks;
+    int score;
+    uint64_t hash;
+};
+
+//calls the game method `input` maps to, moves report MOVE
+template <class Game>
+inline ProcessResult play_input(Game& game, GameInput input) {
+    switch (input) {
+        case INPUT_ROTATE: game.rotate();
+            break;
+        case INPUT_LEFT: game.move_left();
+            break;
+        case INPUT_RIGHT: game.move_right();
+            break;
+        case INPUT_DOWN: return game.process();
+        case INPUT_DROP: return game.drop();
+    }
+    return MOVE;
+}
+
+//the same, telling what changed in `out`
+template <class Game>
+inline ProcessResult play_input(Game& game, GameInput input, tick_result& out) {
+    switch (input) {
+        case INPUT_ROTATE: game.rotate(out);
+            break;
+        case INPUT_LEFT: game.move_left(out);
+            break;
+        case INPUT_RIGHT: game.move_right(out);
+            break;
+        case INPUT_DOWN: return game.process(out);
+        case INPUT_DROP: return game.drop(out);
+    }
+    return MOVE;
+}
+
+//bits appended lowest first, flushed to `out` a byte at a time
+struct bit_sink {
+    std::vector<uint8_t>* out;
+    uint64_t bits;
+    int count;
+
+    explicit bit_sink(std::vector<uint8_t>* out = 0);
+    //`value` must fit in `length` bits, at most 32
+    void put(uint64_t value, int length);
+    //pads the last byte with zeros
+    void flush();
+    //bits written so far
+    uint64_t offset() const;
+};
+
+//reads what a bit_sink wrote, zeros past the end
+struct bit_source {
+    const uint8_t* cursor;
+    const uint8_t* end;
+    uint64_t bits;
+    int count;
+    //zero bits read past the end
+    int past_end;
+
+    bit_source(const uint8_t* begin = 0, const uint8_t* end = 0);
+    void fill();
+    uint64_t take(int length);
+    //the reads went past the end
+    bool overrun() const;
+};
+
+/*
+ Records a game as its header and the inputs it was played with.
+
+ A tick is a process() call, gravity moving the figure one row down. Every
+ other input is stored as 3 bits: whether ticks went by since the previous
+ one, then the input. The ticks themselves, when there were any, follow as
+ an Elias gamma code, so a run of 1 takes 1 bit and a run of 4 takes 5.
+ A placement of a bot, a few moves and a drop, packs into 2 bytes or so.
+
+ Games recorded through play() also get a keyframe every `keyframe_interval`
+ steps, a step being one input or tick: the game state at that point and
+ where its input starts in the stream, so a reader can seek without playing
+ the game from the start. The locked cells take a bit each, the empty rows
+ on top aside.
+
+ Layout, numbers are LEB128 varints unless noted:
+     REPLAY_MAGIC, format version, engine version,
+     seed, game, bag, preview, rows, cols,
+     inputs, ticks, score, hash (8 bytes little endian),
+     stream length in bytes, stream,
+     keyframes,
+     index, step and file offset of every keyframe (8 bytes little endian each),
+     index offset, keyframe count (8 bytes little endian each), REPLAY_INDEX_MAGIC.
+ */
+class ReplayWriter {
+public:
+    explicit ReplayWriter(const replay_header& header, int keyframe_interval = REPLAY_KEYFRAME_INTERVAL);
+    virtual ~ReplayWriter();
+
+    //records an input the game was just given
+    void record(GameInput input);
+
+    //gives `input` to the game and records it
+    template <class Game>
+    ProcessResult play(Game& game, GameInput input) {
+        prepare(game, input);
+        return play_input(game, input);
+    }
+
+    //the same, telling what changed in `out`
+    template <class Game>
+    ProcessResult play(Game& game, GameInput input, tick_result& out) {
+        prepare(game, input);
+        return play_input(game, input, out);
+    }
+
+    //seals the replay with the state the game ended in, nothing is recorded after it
+    void finish(uint64_t hash, int score);
+    bool is_finished() const;
+    //the encoded replay, complete once finished
+    const std::vector<uint8_t>& data() const;
+    bool save(const char* path) const;
+
+    long long inputs() const;
+    long long ticks() const;
+    int keyframes() const;
+
+private:
+    replay_header header;
+    int keyframe_interval;
+    long long next_keyframe;
+    std::vector<uint8_t> stream;
+    bit_sink packer;
+    std::vector<uint8_t> frames;
+    //step of every keyframe and its offset in frames
+    std::vector<uint64_t> index;
+    std::vector<uint8_t> bytes;
+    //ticks since the last input other than INPUT_DOWN
+    uint64_t pending;
+    long long input_count;
+    long long tick_count;
+    bool finished;
+
+    void keyframe(const game_state& state);
+
+    //records `input` about to be given to the game
+    template <class Game>
+    void prepare(Game& game, GameInput input) {
+        //keyframes go in front of an input, ticks are only counted until the next one
+        if (input != INPUT_DOWN && input_count + tick_count >= next_keyframe) {
+            game_state state;
+            game.save(state);
+            keyframe(state);
+        }
+        record(input);
+    }
+};
+
+/*
+ Reads a replay in place, see ReplayWriter for the layout.
+
+ next() hands out the recorded inputs in order, ticks as INPUT_DOWN, until
+ the replay is over. seek() jumps to any step through the nearest keyframe
+ before it.
+ */
+class ReplayReader {
+public:
+    ReplayReader(const uint8_t* data, size_t size);
+    virtual ~ReplayReader();
+
+    //the replay is complete and well formed so far
+    bool is_valid() const;
+    const replay_header& header() const;
+    long long inputs() const;
+    long long ticks() const;
+    //inputs and ticks, every one a step
+    long long steps() const;
+    int score() const;
+    uint64_t hash() const;
+    int keyframes() const;
+    //steps handed out by next()
+    long long position() const;
+
+    bool next(GameInput& input) {
+        if (pending) {
+            pending--;
+            step++;
+            input = INPUT_DOWN;
+            return true;
+        }
+        if (waiting >= 0) {
+            input = (GameInput) waiting;
+            waiting = -1;
+            step++;
+            return true;
+        }
+        return next_input(input);
+    }
+
+    //goes back to the first input
+    void restart();
+
+    /*
+     Makes next() continue from step `target` and puts `game`, made on the
+     piece queue of the replay, in the state the recorded game was in right
+     before it. Only the steps after the nearest keyframe are played.
+
+     @result false when the replay is not valid or has fewer steps
+     */
+    template <class Game>
+    bool seek(long long target, Game& game) {
+        if (!valid || target < 0 || target > steps()) {
+            return false;
+        }
+        game_state state;
+        int k = find_keyframe(target);
+        if (k < 0) {
+            Game fresh(info.queue(), info.rows, info.cols);
+            fresh.save(state);
+            restart();
+        } else if (!load_keyframe(k, state)) {
+            return false;
+        }
+        game.restore(state);
+        GameInput input;
+        while (step < target && next(input)) {
+            play_input(game, input);
+        }
+        return valid;
+    }
+
+private:
+    replay_header info;
+    bool valid;
+    long long input_count;
+    long long tick_count;
+    int final_score;
+    uint64_t final_hash;
+    const uint8_t* data;
+    const uint8_t* stream;
+    const uint8_t* stream_end;
+    const uint8_t* index;
+    int keyframe_count;
+
+    //reading position
+    bit_source source;
+    long long step;
+    //ticks to hand out before the input `waiting`, -1 when there is none
+    uint64_t pending;
+    int waiting;
+    //ticks of the next run played before the keyframe it was read from
+    uint64_t skip;
+    long long inputs_left;
+    long long ticks_left;
+
+    bool next_input(GameInput& input);
+    //marks the replay malformed and ends it
+    bool fail();
+    bool read_index(const uint8_t* end);
+    //last keyframe at or before `target`, -1 when there is none
+    int find_keyframe(long long target) const;
+    //decodes keyframe `k` and continues reading from it
+    bool load_keyframe(int k, game_state& state);
+};
+/*
+ Plays replays back as fast as the game goes, without rendering.
+
+ The game is a TetrisGame when the replay was recorded on the default well
+ and a DynamicTetrisGame otherwise.
+ */
+class ReplayPlayer {
+public:
+    static replay_result verify(const uint8_t* data, size_t size);
+    //maps the file, see MappedFile
+    static replay_result verify(const char* path);
+
+    //gives every input of `reader` to `game`
+    template <class Game>
+    static void play(ReplayReader& reader, Game& game) {
+        GameInput input;
+        while (reader.next(input)) {
+            play_input(game, input);
+        }
+    }
+};
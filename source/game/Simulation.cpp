@@ -0,0 +1,314 @@
+#include <assert.h>
+#include <chrono>
+#include <stdlib.h>
+
+#include "Simulation.h"
+#include "Replay.h"
+
+SimulationConfig::SimulationConfig() {
+    this->tick_rate = 60;
+    this->gravity_ticks = 60;
+    this->max_catch_up = 5;
+    this->das = 0.167;
+    this->arr = 0.033;
+}
+
+//held keys of these inputs repeat
+static bool repeats(int input) {
+    return input == INPUT_LEFT || input == INPUT_RIGHT || input == INPUT_DOWN;
+}
+
+template <int Rows, int Cols>
+BasicSimulation<Rows, Cols>::BasicSimulation(game_type& game, const SimulationConfig& config) : game(game), config(config) {
+    assert(config.tick_rate > 0 && config.max_catch_up > 0 && config.das > 0 && config.arr > 0);
+    this->time = 0;
+    this->keys_head = 0;
+    this->keys_tail = 0;
+    this->running = false;
+    this->owed = 0;
+    this->gravity = config.gravity_ticks;
+    this->tick_count = 0;
+    this->dropped = 0;
+    for (int k = 0; k < SIMULATION_KEYS; ++k) {
+        this->repeat_at[k] = 0;
+    }
+    this->pressed = 0;
+    this->pressed_time = -1;
+    this->last_figure = 0;
+    this->last_row = 0;
+    this->last_col = 0;
+    this->changed_rows = 0;
+    this->over = false;
+    for (int i = 0; i < MAX_FIELD_ROWS; ++i) {
+        this->row_ticks[i] = 0;
+    }
+    publish();
+}
+
+template <int Rows, int Cols>
+BasicSimulation<Rows, Cols>::~BasicSimulation() {
+    stop();
+}
+
+template <int Rows, int Cols>
+double BasicSimulation<Rows, Cols>::clock() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::start() {
+    if (!running.exchange(true)) {
+        time = clock();
+        owed = 0;
+        for (int k = 0; k < SIMULATION_KEYS; ++k) {
+            repeat_at[k] = 0;
+        }
+        thread = std::thread(&BasicSimulation::run, this);
+    }
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::is_running() const {
+    return running;
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::is_over() const {
+    return over;
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::press(GameInput input, double time) {
+    return push(input, KEY_PRESSED, time);
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::release(GameInput input, double time) {
+    return push(input, KEY_RELEASED, time);
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::input(GameInput input) {
+    return push(input, KEY_TAPPED, running ? clock() : time);
+}
+
+template <int Rows, int Cols>
+bool BasicSimulation<Rows, Cols>::push(GameInput input, KeyAction action, double time) {
+    uint32_t h = keys_head.load(std::memory_order_relaxed);
+    if (h - keys_tail.load(std::memory_order_acquire) == SIMULATION_INPUTS) {
+        return false;
+    }
+    key_event& e = keys[h % SIMULATION_INPUTS];
+    e.time = time;
+    e.input = (uint8_t) input;
+    e.action = (uint8_t) action;
+    keys_head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+template <int Rows, int Cols>
+int BasicSimulation<Rows, Cols>::advance(double seconds) {
+    double period = 1.0 / config.tick_rate;
+    owed += seconds;
+    int due = (int) (owed / period);
+    int run = due < config.max_catch_up ? due : config.max_catch_up;
+    for (int k = 0; k < run; ++k) {
+        tick();
+    }
+    if (due > run) {
+        dropped += due - run;
+        time += (due - run) * period;
+    }
+    owed -= due * period;
+    return run;
+}
+
+template <int Rows, int Cols>
+const board_snapshot& BasicSimulation<Rows, Cols>::snapshot() {
+    return snapshots.read();
+}
+
+template <int Rows, int Cols>
+float BasicSimulation<Rows, Cols>::interpolation(const board_snapshot& s) const {
+    float alpha = (float) ((clock() - s.time) * config.tick_rate);
+    return alpha < 0 ? 0 : alpha > 1 ? 1 : alpha;
+}
+
+template <int Rows, int Cols>
+uint64_t BasicSimulation<Rows, Cols>::ticks() const {
+    return tick_count;
+}
+
+template <int Rows, int Cols>
+uint64_t BasicSimulation<Rows, Cols>::dropped_ticks() const {
+    return dropped;
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::step() {
+    uint32_t t = keys_tail.load(std::memory_order_relaxed);
+    uint32_t h = keys_head.load(std::memory_order_acquire);
+    for (; t != h; ++t) {
+        const key_event& e = keys[t % SIMULATION_INPUTS];
+        if (e.action != KEY_TAPPED && e.time > time) {
+            break;
+        }
+        repeat(e.time);
+        play_key(e);
+    }
+    keys_tail.store(t, std::memory_order_release);
+    repeat(time);
+
+    if (config.gravity_ticks > 0 && --gravity <= 0) {
+        give(INPUT_DOWN);
+        gravity = config.gravity_ticks;
+    }
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::play_key(const key_event& e) {
+    if (e.action == KEY_RELEASED) {
+        repeat_at[e.input] = 0;
+        return;
+    }
+    if (e.action == KEY_PRESSED && repeats(e.input)) {
+        repeat_at[e.input] = e.time + config.das;
+    }
+    ++pressed;
+    if (pressed_time < 0) {
+        pressed_time = e.time;
+    }
+    give((GameInput) e.input);
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::repeat(double until) {
+    while (true) {
+        int next = -1;
+        for (int k = 0; k < SIMULATION_KEYS; ++k) {
+            if (repeat_at[k] > 0 && repeat_at[k] <= until && (next < 0 || repeat_at[k] < repeat_at[next])) {
+                next = k;
+            }
+        }
+        if (next < 0) {
+            return;
+        }
+        repeat_at[next] += config.arr;
+        give((GameInput) next);
+    }
+}
+
+template <int Rows, int Cols>
+ProcessResult BasicSimulation<Rows, Cols>::play(GameInput input, tick_result& out) {
+    return play_input(game, input, out);
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::track(const tick_result& out) {
+    if (out.result == GAME_OVER) {
+        over = true;
+    }
+    if (!out.locked) {
+        return;
+    }
+    //a figure locked where it fell stays taken, its rows are only in changed_rows when they moved
+    changed_rows |= out.changed_rows;
+    //every row down to the lowest cleared one shifted, even where the spawned figure hides the change
+    if (out.cleared) {
+        int bottom = 63 - __builtin_clzll(out.cleared);
+        changed_rows |= bottom == 63 ? ~0ull : (2ull << bottom) - 1;
+    }
+    const geometry_mask& g = FigureTable::find_shape(out.locked).rotations[(int) out.locked_rotation];
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (g.rows[r]) {
+            changed_rows |= 1ull << (out.locked_row + r);
+        }
+    }
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::track(uint64_t rows) {
+    changed_rows |= rows;
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::give(GameInput input) {
+    //keys, repeats and gravity due after the game over are dropped
+    if (over) {
+        return;
+    }
+    play(input, result);
+    track(result);
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::tick() {
+    time += 1.0 / config.tick_rate;
+    step();
+    ++tick_count;
+    publish();
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::publish() {
+    board_snapshot& s = snapshots.back();
+    const typename game_type::row_type* rows = game.get_rows();
+    s.field_rows = game.get_field_rows();
+    s.field_cols = game.get_field_cols();
+    for (uint64_t rest = changed_rows; rest; rest &= rest - 1) {
+        row_ticks[__builtin_ctzll(rest)] = tick_count;
+    }
+    changed_rows = 0;
+    for (int i = 0; i < s.field_rows; ++i) {
+        s.rows[i] = rows[i];
+        s.row_ticks[i] = row_ticks[i];
+    }
+    const figure_shape* f = game.get_figure();
+    s.figure = f ? (int8_t) FigureTable::find_id(f) : 0;
+    s.rotation = (int8_t) game.get_rotation();
+    s.row = (int8_t) game.get_row();
+    s.col = (int8_t) game.get_col();
+    //figures only fall, one higher up than the last is a new figure
+    bool same = s.figure && s.figure == last_figure && s.row >= last_row;
+    s.last_row = same ? last_row : s.row;
+    s.last_col = same ? last_col : s.col;
+    s.score = game.get_score();
+    s.tick = tick_count;
+    s.time = time;
+    s.keys = pressed;
+    s.key_time = pressed_time;
+    pressed_time = -1;
+    last_figure = s.figure;
+    last_row = s.row;
+    last_col = s.col;
+    snapshots.publish();
+}
+
+template <int Rows, int Cols>
+void BasicSimulation<Rows, Cols>::run() {
+    double last = clock();
+    while (running) {
+        double t = clock();
+        advance(t - last);
+        last = t;
+        double wait = (1.0 / config.tick_rate - owed) - (clock() - t);
+        if (wait > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+    }
+}
+
+//the wells BasicTetrisGame is instantiated for
+template class BasicSimulation<GAME_FIELD_ROWS, GAME_FIELD_COLS>;
+template class BasicSimulation<GAME_FIELD_ROWS, 18>;
+template class BasicSimulation<GAME_FIELD_ROWS, 42>;
+template class BasicSimulation<42, GAME_FIELD_COLS>;
+template class BasicSimulation<DYNAMIC_SIZE, DYNAMIC_SIZE>;
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <stdint.h>
+#include "TetrisGame.h"
+#include "TripleBuffer.h"
+
+//key events waiting for their tick at most
+#define SIMULATION_INPUTS 64
+//inputs a key can be bound to, see GameInput
+#define SIMULATION_KEYS (INPUT_DROP + 1)
+
+struct SimulationConfig {
+    //ticks per second
+    int tick_rate;
+    //ticks between two gravity steps, 0 for no gravity
+    int gravity_ticks;
+    //most ticks run at once to catch up after a stall, the rest of the delay is dropped
+    int max_catch_up;
+    //seconds a held left, right or down key waits before it repeats, then seconds between repeats
+    double das;
+    double arr;
+
+    SimulationConfig();
+};
+
+enum KeyAction {
+    KEY_PRESSED,
+    KEY_RELEASED,
+    //pressed and released, played by the next tick whenever it happened
+    KEY_TAPPED
+};
+
+struct key_event {
+    //Simulation::clock() seconds the key went down or up
+    double time;
+    uint8_t input;
+    uint8_t action;
+};
+
+//what the renderer needs of the game after a tick
+struct board_snapshot {
+    //well of the game, border columns included
+    int field_rows;
+    int field_cols;
+    //locked cells, as get_rows() has them, the first field_rows are valid
+    uint64_t rows[MAX_FIELD_ROWS];
+    //tick the locked cells of each row last changed in, a reader that saw the tick has the row
+    uint64_t row_ticks[MAX_FIELD_ROWS];
+    //FigureTable id of the falling figure, 0 when there is none
+    int8_t figure;
+    int8_t rotation;
+    int8_t row;
+    int8_t col;
+    //where the figure was one tick before, the same as row and col for a new one
+    int8_t last_row;
+    int8_t last_col;
+    int score;
+    uint64_t tick;
+    //simulation seconds at the end of the tick
+    double time;
+    //key presses played so far, and when the first one the tick played was pressed
+    uint64_t keys;
+    double key_time;
+};
+
+/*
+ Runs the game on its own thread at a fixed tick rate.
+
+ Every tick plays the key events stamped before its end in the order they
+ happened, with the auto repeat of the held keys in between at the exact
+ times it falls due, then gravity every `gravity_ticks` ticks. It publishes
+ a board_snapshot through a TripleBuffer afterwards. The game moves by
+ ticks only, so how fast it plays does not depend on how long frames take.
+ A thread woken late runs the ticks it owes, up to `max_catch_up`, and
+ drops the rest.
+
+ The game belongs to the simulation thread while it runs. One other thread
+ sends keys with press(), release() and input(), and reads the game through
+ snapshot(). Snapshots carry the size of the well, so a reader draws any
+ BasicTetrisGame the simulation runs.
+
+ The game is played through its tick_result overloads, which tell the rows
+ whose locked cells changed. Snapshots stamp those rows with the tick, so a
+ reader that skipped snapshots still only looks at the rows that changed
+ since the last one it saw.
+ */
+template <int Rows, int Cols>
+class BasicSimulation {
+public:
+    typedef BasicTetrisGame<Rows, Cols> game_type;
+
+    BasicSimulation(game_type& game, const SimulationConfig& config = SimulationConfig());
+    virtual ~BasicSimulation();
+
+    //steady clock seconds, key times are in them once the thread runs
+    static double clock();
+
+    //simulation time starts at clock() and runs with it
+    void start();
+    //waits for the tick in progress
+    void stop();
+    bool is_running() const;
+    //an input ended the game, nothing is played any more; for the simulation thread
+    bool is_over() const;
+
+    //queue keys in the order of their times; false when the queue is full and the key is lost
+    bool press(GameInput input, double time);
+    bool release(GameInput input, double time);
+    //an input played by the next tick
+    bool input(GameInput input);
+
+    /*
+     Runs the ticks due `seconds` after the previous call. The thread calls
+     it, without one it steps the game by hand from simulation time 0.
+
+     @result the ticks run
+     */
+    int advance(double seconds);
+
+    //the latest snapshot, from one reader thread, valid until the next call
+    const board_snapshot& snapshot();
+    //how far the time is from the snapshot to the next tick, 0 to 1
+    float interpolation(const board_snapshot& s) const;
+
+    uint64_t ticks() const;
+    //ticks dropped by the catch up limit
+    uint64_t dropped_ticks() const;
+
+protected:
+    game_type& game;
+    SimulationConfig config;
+    //simulation seconds at the end of the tick running
+    double time;
+
+    //one tick of the game, the keys due and then gravity when it is due
+    virtual void step();
+    //gives an input to the game, telling what changed in `out`
+    virtual ProcessResult play(GameInput input, tick_result& out);
+    //notes the rows whose locked cells `out` changed and a game over, for calls of the game outside play()
+    void track(const tick_result& out);
+    //the same for changes without a tick_result, such as a restore()
+    void track(uint64_t rows);
+
+private:
+    TripleBuffer<board_snapshot> snapshots;
+    //keys from the sending thread to the simulation thread
+    key_event keys[SIMULATION_INPUTS];
+    std::atomic<uint32_t> keys_head;
+    std::atomic<uint32_t> keys_tail;
+    std::thread thread;
+    std::atomic<bool> running;
+    double owed;
+    int gravity;
+    std::atomic<uint64_t> tick_count;
+    std::atomic<uint64_t> dropped;
+    //when each held key repeats next, 0 for keys that are up or do not repeat
+    double repeat_at[SIMULATION_KEYS];
+    uint64_t pressed;
+    //press time of the first key played since the last snapshot, -1 for none
+    double pressed_time;
+    //the figure of the last snapshot published
+    int8_t last_figure;
+    int8_t last_row;
+    int8_t last_col;
+    //what the last input changed
+    tick_result result;
+    //rows with locked cells changed since the last snapshot, and the tick every row last changed in
+    uint64_t changed_rows;
+    uint64_t row_ticks[MAX_FIELD_ROWS];
+    //an input returned GAME_OVER, a finished game spawns again when it is processed
+    bool over;
+
+    bool push(GameInput input, KeyAction action, double time);
+    //plays `input` and tracks what it changed
+    void give(GameInput input);
+    void play_key(const key_event& e);
+    //plays the repeats of the held keys due by `until`, in time order
+    void repeat(double until);
+    void tick();
+    void publish();
+    void run();
+
+    //copying disabled
+    BasicSimulation(const BasicSimulation&);
+    const BasicSimulation& operator=(const BasicSimulation&);
+};
+
+typedef BasicSimulation<GAME_FIELD_ROWS, GAME_FIELD_COLS> Simulation;
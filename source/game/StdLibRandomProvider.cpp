@@ -1,9 +1,15 @@
+#include <cstring>
+#include <type_traits>
 #include "StdLibRandomProvider.h"
 
 StdLibRandomProvider::StdLibRandomProvider() {
     rnd_e.seed(std::time(0));
 }
 
+StdLibRandomProvider::StdLibRandomProvider(unsigned seed) {
+    rnd_e.seed(seed);
+}
+
 StdLibRandomProvider::~StdLibRandomProvider() = default;
 
 int StdLibRandomProvider::next_int(int high_limit) {
@@ -17,3 +23,12 @@ float StdLibRandomProvider::next_float(float high_limit) {
 
 }
 
+void StdLibRandomProvider::save(rng_state& state) const {
+    static_assert(sizeof (rnd_e) <= sizeof (state.words), "engine does not fit in rng_state");
+    static_assert(std::is_trivially_copyable<std::default_random_engine>::value, "engine is not trivially copyable");
+    std::memcpy(state.words, &rnd_e, sizeof (rnd_e));
+}
+
+void StdLibRandomProvider::restore(const rng_state& state) {
+    std::memcpy(&rnd_e, state.words, sizeof (rnd_e));
+}
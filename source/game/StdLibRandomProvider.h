@@ -8,9 +8,12 @@
 class StdLibRandomProvider : public RandomNumberProvider{
 public:
     StdLibRandomProvider();
+    StdLibRandomProvider(unsigned seed);
     virtual ~StdLibRandomProvider();
     virtual int next_int(int high_limit);
     virtual float next_float(float high_limit);
+    virtual void save(rng_state& state) const;
+    virtual void restore(const rng_state& state);
 private:
     std::default_random_engine rnd_e;
 };
@@ -0,0 +1,386 @@
+#include <assert.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "TetrisBatch.h"
+
+#define FIELD_PLANES (GAME_FIELD_ROWS + GEOMETRY_SIZE)
+#define LANE_ALIGN 16
+
+namespace {
+
+    /*
+     Lane operations the kernels are written against. Every lane is one board,
+     a lane mask is all ones for the boards taking part and zero otherwise.
+     */
+    struct ScalarOps {
+        typedef row_mask vec;
+        enum { width = 1 };
+
+        static vec load(const row_mask* p) { return *p; }
+        static void store(row_mask* p, vec v) { *p = v; }
+        static vec zero() { return 0; }
+        static vec and_(vec a, vec b) { return a & b; }
+        static vec or_(vec a, vec b) { return a | b; }
+        static vec andnot(vec a, vec b) { return (vec) (~a & b); }
+        static vec shr1(vec a) { return (vec) (a >> 1); }
+        static vec shl1(vec a) { return (vec) (a << 1); }
+        static vec nonzero(vec a) { return a ? FULL_ROW_MASK : 0; }
+        static vec is_full(vec a) { return a == FULL_ROW_MASK ? FULL_ROW_MASK : 0; }
+        static bool none(vec a) { return !a; }
+    };
+
+#if defined(__SSE2__)
+    struct Sse2Ops {
+        typedef __m128i vec;
+        enum { width = 8 };
+
+        static vec load(const row_mask* p) { return _mm_loadu_si128((const __m128i*) p); }
+        static void store(row_mask* p, vec v) { _mm_storeu_si128((__m128i*) p, v); }
+        static vec zero() { return _mm_setzero_si128(); }
+        static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+        static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+        static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+        static vec shr1(vec a) { return _mm_srli_epi16(a, 1); }
+        static vec shl1(vec a) { return _mm_slli_epi16(a, 1); }
+        static vec nonzero(vec a) { return _mm_andnot_si128(_mm_cmpeq_epi16(a, zero()), _mm_set1_epi16(-1)); }
+        static vec is_full(vec a) { return _mm_cmpeq_epi16(a, _mm_set1_epi16(-1)); }
+        static bool none(vec a) { return _mm_movemask_epi8(_mm_cmpeq_epi16(a, zero())) == 0xFFFF; }
+    };
+#endif
+
+#if defined(__AVX2__)
+    struct Avx2Ops {
+        typedef __m256i vec;
+        enum { width = 16 };
+
+        static vec load(const row_mask* p) { return _mm256_loadu_si256((const __m256i*) p); }
+        static void store(row_mask* p, vec v) { _mm256_storeu_si256((__m256i*) p, v); }
+        static vec zero() { return _mm256_setzero_si256(); }
+        static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+        static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+        static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+        static vec shr1(vec a) { return _mm256_srli_epi16(a, 1); }
+        static vec shl1(vec a) { return _mm256_slli_epi16(a, 1); }
+        static vec nonzero(vec a) { return _mm256_andnot_si256(_mm256_cmpeq_epi16(a, zero()), _mm256_set1_epi16(-1)); }
+        static vec is_full(vec a) { return _mm256_cmpeq_epi16(a, _mm256_set1_epi16(-1)); }
+        static bool none(vec a) { return _mm256_testz_si256(a, a); }
+    };
+#endif
+
+    //moves the figures of the lanes in left/right by one column when nothing is in the way
+    template <class V>
+    void shift_kernel(row_mask* piece, const row_mask* field,
+            const row_mask* left, const row_mask* right, row_mask* moved, int stride) {
+        typedef typename V::vec vec;
+        for (int k = 0; k < stride; k += V::width) {
+            vec l = V::load(left + k);
+            vec r = V::load(right + k);
+            if (V::none(V::or_(l, r))) {
+                V::store(moved + k, V::zero());
+                continue;
+            }
+            vec cl = V::zero();
+            vec cr = V::zero();
+            for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+                vec p = V::load(piece + i * stride + k);
+                vec f = V::load(field + i * stride + k);
+                cl = V::or_(cl, V::and_(V::shr1(p), f));
+                cr = V::or_(cr, V::and_(V::shl1(p), f));
+            }
+            vec ml = V::andnot(V::nonzero(cl), l);
+            vec mr = V::andnot(V::nonzero(cr), r);
+            vec m = V::or_(ml, mr);
+            for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+                vec p = V::load(piece + i * stride + k);
+                vec s = V::or_(V::and_(ml, V::shr1(p)), V::and_(mr, V::shl1(p)));
+                V::store(piece + i * stride + k, V::or_(s, V::andnot(m, p)));
+            }
+            V::store(moved + k, m);
+        }
+    }
+
+    /*
+     One gravity tick for the active lanes. Figures that fit one row lower move
+     down, the others are locked into the field and their lanes are flagged in
+     full when that completed a row.
+     */
+    template <class V>
+    void gravity_kernel(row_mask* piece, row_mask* field,
+            const row_mask* active, row_mask* moved, row_mask* full, int stride) {
+        typedef typename V::vec vec;
+        for (int k = 0; k < stride; k += V::width) {
+            vec a = V::load(active + k);
+            if (V::none(a)) {
+                V::store(moved + k, V::zero());
+                V::store(full + k, V::zero());
+                continue;
+            }
+            vec c = V::zero();
+            for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+                vec p = V::load(piece + i * stride + k);
+                vec f = V::load(field + (i + 1) * stride + k);
+                c = V::or_(c, V::and_(p, f));
+            }
+            c = V::nonzero(c);
+            vec down = V::andnot(c, a);
+            vec lock = V::and_(c, a);
+            vec any_full = V::zero();
+            for (int i = GAME_FIELD_ROWS - 1; i >= 0; --i) {
+                vec p = V::load(piece + i * stride + k);
+                vec above = i > 0 ? V::load(piece + (i - 1) * stride + k) : V::zero();
+                vec f = V::or_(V::load(field + i * stride + k), V::and_(lock, p));
+                V::store(field + i * stride + k, f);
+                any_full = V::or_(any_full, V::is_full(f));
+                V::store(piece + i * stride + k, V::or_(V::and_(down, above), V::andnot(a, p)));
+            }
+            V::store(moved + k, down);
+            V::store(full + k, V::and_(any_full, lock));
+        }
+    }
+}
+
+TetrisBatch::TetrisBatch(int boards, unsigned seed, BatchKernel kernel) {
+    assert(boards > 0);
+    this->boards = boards;
+    this->stride = (boards + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN;
+    this->kernel_type = kernel > best_kernel() ? best_kernel() : kernel;
+    this->alive_count = 0;
+    field.assign(FIELD_PLANES * stride, EMPTY_ROW_MASK);
+    for (int i = GAME_FIELD_ROWS; i < FIELD_PLANES; ++i) {
+        for (int k = 0; k < stride; ++k) {
+            field[i * stride + k] = FULL_ROW_MASK;
+        }
+    }
+    piece.assign(GAME_FIELD_ROWS * stride, 0);
+    left.assign(stride, 0);
+    right.assign(stride, 0);
+    active.assign(stride, 0);
+    moved_h.assign(stride, 0);
+    moved.assign(stride, 0);
+    full.assign(stride, 0);
+    figures.assign(boards, (const figure_shape*) 0);
+    rotations.assign(boards, 0);
+    pos_i.assign(boards, 0);
+    pos_j.assign(boards, 0);
+    scores.assign(boards, 0);
+    results.assign(boards, MOVE);
+    queues.reserve(boards);
+    for (int k = 0; k < boards; ++k) {
+        queues.push_back(PieceQueue(seed, k));
+        if (spawn(k)) {
+            alive_count++;
+        } else {
+            results[k] = GAME_OVER;
+        }
+    }
+}
+
+TetrisBatch::~TetrisBatch() {
+}
+
+BatchKernel TetrisBatch::best_kernel() {
+#if defined(__AVX2__)
+    return KERNEL_AVX2;
+#elif defined(__SSE2__)
+    return KERNEL_SSE2;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+int TetrisBatch::size() const {
+    return boards;
+}
+
+BatchKernel TetrisBatch::kernel() const {
+    return kernel_type;
+}
+
+ProcessResult TetrisBatch::result(int board) const {
+    return (ProcessResult) results[board];
+}
+
+bool TetrisBatch::is_over(int board) const {
+    return !figures[board];
+}
+
+int TetrisBatch::get_score(int board) const {
+    return scores[board];
+}
+
+int TetrisBatch::alive() const {
+    return alive_count;
+}
+
+bool TetrisBatch::is_free(int board, int i, int j) const {
+    row_mask cells = field[i * stride + board] | piece[i * stride + board];
+    return !(cells >> j & 1);
+}
+
+void TetrisBatch::step(const uint8_t* actions) {
+    for (int k = 0; k < boards; ++k) {
+        left[k] = 0;
+        right[k] = 0;
+        active[k] = 0;
+        if (!figures[k]) {
+            continue;
+        }
+        switch (actions[k]) {
+            case ACTION_LEFT:
+                //same left bound rule as TetrisGame::move
+                if (pos_j[k] > 0) {
+                    left[k] = FULL_ROW_MASK;
+                }
+                break;
+            case ACTION_RIGHT: right[k] = FULL_ROW_MASK;
+                break;
+            case ACTION_ROTATE: rotate(k);
+                break;
+            case ACTION_DROP: drop(k);
+                break;
+        }
+        if (figures[k]) {
+            active[k] = FULL_ROW_MASK;
+        }
+    }
+
+    switch (kernel_type) {
+#if defined(__AVX2__)
+        case KERNEL_AVX2:
+            shift_kernel<Avx2Ops>(&piece[0], &field[0], &left[0], &right[0], &moved_h[0], stride);
+            gravity_kernel<Avx2Ops>(&piece[0], &field[0], &active[0], &moved[0], &full[0], stride);
+            break;
+#endif
+#if defined(__SSE2__)
+        case KERNEL_SSE2:
+            shift_kernel<Sse2Ops>(&piece[0], &field[0], &left[0], &right[0], &moved_h[0], stride);
+            gravity_kernel<Sse2Ops>(&piece[0], &field[0], &active[0], &moved[0], &full[0], stride);
+            break;
+#endif
+        default:
+            shift_kernel<ScalarOps>(&piece[0], &field[0], &left[0], &right[0], &moved_h[0], stride);
+            gravity_kernel<ScalarOps>(&piece[0], &field[0], &active[0], &moved[0], &full[0], stride);
+    }
+
+    for (int k = 0; k < boards; ++k) {
+        if (!active[k]) {
+            continue;
+        }
+        if (moved_h[k]) {
+            pos_j[k] += left[k] ? -1 : 1;
+        }
+        if (moved[k]) {
+            pos_i[k]++;
+            results[k] = MOVE;
+        } else {
+            settle(k, full[k] != 0);
+        }
+    }
+}
+
+bool TetrisBatch::collides(int k, const geometry_mask& geo, int i, int j) const {
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (field[(i + r) * stride + k] & (row_mask) (geo.rows[r] << j)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TetrisBatch::place(int k, bool on) {
+    const geometry_mask& geo = figures[k]->rotations[(int) rotations[k]];
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        int i = pos_i[k] + r;
+        if (i < GAME_FIELD_ROWS) {
+            piece[i * stride + k] = on ? (row_mask) (geo.rows[r] << pos_j[k]) : 0;
+        }
+    }
+}
+
+void TetrisBatch::lock(int k) {
+    for (int i = pos_i[k]; i < pos_i[k] + GEOMETRY_SIZE && i < GAME_FIELD_ROWS; ++i) {
+        field[i * stride + k] |= piece[i * stride + k];
+        piece[i * stride + k] = 0;
+    }
+}
+
+bool TetrisBatch::rotate(int k) {
+    //same bound rules as TetrisGame::move for a rotation
+    const geometry_mask& geo = figures[k]->rotations[(int) rotations[k]];
+    if (pos_j[k] == 0) {
+        return false;
+    }
+    if (pos_i[k] + geo.height >= GAME_FIELD_ROWS - 1) {
+        return false;
+    }
+    if (pos_j[k] + geo.right >= GAME_FIELD_COLS) {
+        return false;
+    }
+    int next = rotations[k] == MAX_ROTATION_INDEX ? 0 : rotations[k] + 1;
+    if (collides(k, figures[k]->rotations[next], pos_i[k], pos_j[k])) {
+        return false;
+    }
+    place(k, false);
+    rotations[k] = next;
+    place(k, true);
+    return true;
+}
+
+void TetrisBatch::drop(int k) {
+    const geometry_mask& geo = figures[k]->rotations[(int) rotations[k]];
+    place(k, false);
+    while (!collides(k, geo, pos_i[k] + 1, pos_j[k])) {
+        pos_i[k]++;
+    }
+    place(k, true);
+    lock(k);
+    settle(k, true);
+}
+
+void TetrisBatch::settle(int k, bool full_rows) {
+    results[k] = DROP;
+    if (full_rows) {
+        int destroyed = destroy(k);
+        if (destroyed) {
+            results[k] = DESTROY;
+            scores[k] += destroyed;
+        }
+    }
+    if (!spawn(k)) {
+        results[k] = GAME_OVER;
+        alive_count--;
+    }
+}
+
+int TetrisBatch::destroy(int k) {
+    int to = GAME_FIELD_ROWS - 1;
+    for (int i = GAME_FIELD_ROWS - 1; i >= 0; --i) {
+        row_mask row = field[i * stride + k];
+        if (row != FULL_ROW_MASK) {
+            field[to-- * stride + k] = row;
+        }
+    }
+    int count = to + 1;
+    for (; to >= 0; --to) {
+        field[to * stride + k] = EMPTY_ROW_MASK;
+    }
+    return count;
+}
+
+bool TetrisBatch::spawn(int k) {
+    figures[k] = &FigureTable::find_shape(queues[k].next().figure);
+    rotations[k] = 0;
+    pos_i[k] = 0;
+    pos_j[k] = SPAWN_COL;
+    if (collides(k, figures[k]->rotations[0], 0, pos_j[k])) {
+        figures[k] = 0;
+        return false;
+    }
+    place(k, true);
+    return true;
+}
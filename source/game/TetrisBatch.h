@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "TetrisGame.h"
+#include "PieceQueue.h"
+
+enum BatchAction {
+    ACTION_NONE,
+    ACTION_LEFT,
+    ACTION_RIGHT,
+    ACTION_ROTATE,
+    ACTION_DROP
+};
+
+enum BatchKernel {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2
+};
+
+/*
+ Many wells stepped in lockstep.
+
+ Occupancy is kept as structure of arrays: row r of every board sits next to
+ each other, same for the row masks of the falling figures. Horizontal moves,
+ gravity, collisions, locking and the full row test then run over all the
+ boards at once with SSE2/AVX2 kernels, picked at compile time, or a scalar
+ fallback. Rotations, drops, line clears and spawns are rare enough to stay
+ per board.
+
+ Board k plays by the same rules as TetrisGame and draws its figures from
+ PieceQueue(seed, k), so stepping it with action a is the same as calling
+ the matching TetrisGame method and then process().
+ */
+class TetrisBatch {
+public:
+    TetrisBatch(int boards, unsigned seed, BatchKernel kernel = best_kernel());
+    virtual ~TetrisBatch();
+
+    //applies one action per board and a gravity tick to every board still in game
+    virtual void step(const uint8_t* actions);
+
+    int size() const;
+    BatchKernel kernel() const;
+    ProcessResult result(int board) const;
+    bool is_over(int board) const;
+    int get_score(int board) const;
+    //number of boards still in game
+    int alive() const;
+    bool is_free(int board, int i, int j) const;
+
+    static BatchKernel best_kernel();
+private:
+    int boards;
+    //lanes are padded to a whole number of the widest vectors
+    int stride;
+    BatchKernel kernel_type;
+    int alive_count;
+    //one plane per row, followed by solid floor planes
+    std::vector<row_mask> field;
+    std::vector<row_mask> piece;
+    //per lane masks, all ones when the lane takes part
+    std::vector<row_mask> left;
+    std::vector<row_mask> right;
+    std::vector<row_mask> active;
+    std::vector<row_mask> moved_h;
+    std::vector<row_mask> moved;
+    std::vector<row_mask> full;
+    //per board state of the falling figure
+    std::vector<const figure_shape*> figures;
+    std::vector<int8_t> rotations;
+    std::vector<int8_t> pos_i;
+    std::vector<int8_t> pos_j;
+    std::vector<int> scores;
+    std::vector<uint8_t> results;
+    std::vector<PieceQueue> queues;
+
+    bool collides(int k, const geometry_mask& geo, int i, int j) const;
+    void place(int k, bool on);
+    void lock(int k);
+    bool rotate(int k);
+    void drop(int k);
+    void settle(int k, bool full_rows);
+    int destroy(int k);
+    bool spawn(int k);
+};
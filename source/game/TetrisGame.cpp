@@ -3,61 +3,61 @@
 #include <algorithm>
 
 #include "TetrisGame.h"
-#include "figures/Figure1.h"
-#include "figures/Figure2.h"
-#include "figures/Figure3.h"
-#include "figures/Figure4.h"
-#include "figures/Figure5.h"
 #include "test.h"
 
-TetrisGame::TetrisGame(RandomNumberProvider* provider) {
+template <int Rows, int Cols>
+BasicTetrisGame<Rows, Cols>::BasicTetrisGame(const PieceQueue& pieces, int rows, int cols) :
+pieces(pieces) {
+    this->rnd_provider = 0;
+    init(rows, cols);
+}
+
+template <int Rows, int Cols>
+BasicTetrisGame<Rows, Cols>::BasicTetrisGame(RandomNumberProvider* provider, int rows, int cols) {
     this->rnd_provider = provider;
-    figures[1] = new Figure1();
-    figures[2] = new Figure2();
-    figures[3] = new Figure3();
-    figures[4] = new Figure4();
-    figures[5] = new Figure5();
+    init(rows, cols);
+}
+
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::init(int rows, int cols) {
+    assert(Rows == DYNAMIC_SIZE || rows == Rows);
+    assert(Cols == DYNAMIC_SIZE || cols == Cols);
+    assert(rows > 0 && rows <= traits::rows_capacity);
+    assert(cols >= GEOMETRY_SIZE && cols <= traits::cols_capacity);
+    this->field_rows = rows;
+    this->field_cols = cols;
+    this->recording = 0;
+    this->events = 0;
+    this->score = 0;
+    this->cleared_rows = 0;
     init_field();
 }
 
-TetrisGame::~TetrisGame() {
-    for (auto & f : figures) {
-        delete f.second;
-    }
+template <int Rows, int Cols>
+BasicTetrisGame<Rows, Cols>::~BasicTetrisGame() {
 }
 
-bool TetrisGame::move(int di, int dj, bool dt, bool spawned) {
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::move(int di, int dj, bool dt, bool spawned) {
     if (!current_f) {
         return false;
     }
     assert(di == 0 || di == 1);
     assert(dj == 0 || std::abs(dj) == 1);
-    geometry geo = current_f->find_geometry(current_t);
+    const geometry_mask& geo = current_f->rotations[(int) current_t];
     //when figure on the left bound
     if ((dj < 0 || dt) && current_j == 0) {
         return false;
     }
     //when figure already on the floor
     if (di > 0 || dt) {
-        int h = calc_height(geo);
-        if (current_i + h >= GAME_FIELD_ROWS - 1) {
+        if (current_i + geo.height >= height() - 1) {
             return false;
         }
     }
-    //collect occupied cells
-    std::vector<int_pair> ocp_cells;
-    if (spawned) {
-        for (int i = 0; i < geo.size(); ++i) {
-            for (int j = 0; j < GEOMETRY_SIZE; ++j) {
-                if (geo[i][j]) {
-                    //check figure doesn't exceed right bound
-                    if (current_j + j + dj >= GAME_FIELD_COLS) {
-                        return false;
-                    }
-                    ocp_cells.push_back({current_i + i, current_j + j});
-                }
-            }
-        }
+    //check figure doesn't exceed right bound
+    if (spawned && current_j + geo.right + dj >= width()) {
+        return false;
     }
     char translate = current_t;
     if (dt) {
@@ -65,26 +65,9 @@ bool TetrisGame::move(int di, int dj, bool dt, bool spawned) {
         if (translate > MAX_ROTATION_INDEX) {
             translate = 0;
         }
-        geo = current_f->find_geometry(translate);
-    }
-    for (int i = 0; i < geo.size(); ++i) {
-        for (int j = 0; j < GEOMETRY_SIZE; ++j) {
-            int offset_i = current_i + i + di;
-            int offset_j = current_j + j + dj;
-            if (geo[i][j] && !is_free(offset_i, offset_j) && !contains_pair(ocp_cells, offset_i, offset_j)) {
-                return false;
-            }
-        }
-    }
-    for (auto & p : ocp_cells) {
-        field[p.first][p.second] = vec4(0.0f, 0.0f, 0.0f, 0.0f);
     }
-    for (int i = 0; i < geo.size(); ++i) {
-        for (int j = 0; j < GEOMETRY_SIZE; ++j) {
-            if (geo[i][j]) {
-                field[current_i + i + di][current_j + j + dj] = current_c;
-            }
-        }
+    if (collides(current_f->rotations[(int) translate], current_i + di, current_j + dj)) {
+        return false;
     }
     current_i += di;
     current_j += dj;
@@ -92,52 +75,132 @@ bool TetrisGame::move(int di, int dj, bool dt, bool spawned) {
     return true;
 }
 
-bool TetrisGame::rotate() {
-    return move(0, 0, true);
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::collides(const geometry_mask& geo, int i, int j) {
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (rows[i + r] & (row_type) ((row_type) geo.rows[r] << j)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void TetrisGame::init_field() {
-    for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
-        for (int j = 0; j < GAME_FIELD_COLS; ++j) {
-            if (is_border(i, j)) {
-                field[i][j] = vec4(1.0f, 0.0f, 0.0f, 6.0f);
-            } else {
-                field[i][j] = vec4(0.0f, 0.0f, 0.0f, 0.0f);
-            }
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::covers(int i, int j) {
+    if (!current_f) {
+        return false;
+    }
+    int r = i - current_i;
+    int c = j - current_j;
+    if (r < 0 || r >= GEOMETRY_SIZE || c < 0 || c >= GEOMETRY_SIZE) {
+        return false;
+    }
+    return current_f->rotations[(int) current_t].rows[r] >> c & 1;
+}
 
+template <int Rows, int Cols>
+uint64_t BasicTetrisGame<Rows, Cols>::lock() {
+    const geometry_mask& geo = current_f->rotations[(int) current_t];
+    uint64_t full = 0;
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (!geo.rows[r]) {
+            continue;
+        }
+        set_row(current_i + r, rows[current_i + r] | (row_type) ((row_type) geo.rows[r] << current_j));
+        if (recording) {
+            recording->touch(current_i + r);
+            recording->occupied[current_i + r] |= (row_type) ((row_type) geo.rows[r] << current_j);
+        }
+        if (rows[current_i + r] == (row_type) ~0) {
+            full |= 1ull << (current_i + r);
+        }
+        for (int c = 0; c < GEOMETRY_SIZE; ++c) {
+            if (geo.rows[r] >> c & 1) {
+                field_row(current_i + r)[current_j + c] = current_c;
+            }
         }
     }
-    spawn();
+    return full;
 }
 
-vec4 TetrisGame::get_color(int i, int j) {
-    return field[i][j];
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::rotate() {
+    return move(0, 0, true);
 }
 
-bool TetrisGame::is_border(int i, int j) {
-    return (j == 0 || j == GAME_FIELD_COLS - 1);
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::init_field() {
+    board_key = 0;
+    features = features_type();
+    features.width = width();
+    for (int i = 0; i < height(); ++i) {
+        rows[i] = empty_row();
+        clear_row(i);
+    }
+    for (int i = height(); i < height() + GEOMETRY_SIZE; ++i) {
+        rows[i] = (row_type) ~0;
+    }
+    spawn();
 }
 
-int TetrisGame::calc_height(geometry& geo) {
-    int h = 0;
-    for (int i = 0; i < geo.size(); ++i) {
-        if (geo[i].any()) {
-            h = i;
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::clear_row(int i) {
+    set_row(i, empty_row());
+    for (int j = 0; j < width(); ++j) {
+        if (is_border(i, j)) {
+            field_row(i)[j] = vec4(1.0f, 0.0f, 0.0f, 6.0f);
+        } else {
+            field_row(i)[j] = vec4(0.0f, 0.0f, 0.0f, 0.0f);
         }
     }
-    return h;
 }
 
-ProcessResult TetrisGame::drop() {
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::set_row(int i, row_type mask) {
+    row_type before = rows[i] & cells_row();
+    row_type after = mask & cells_row();
+    board_key ^= Zobrist::row_key(i, before) ^ Zobrist::row_key(i, after);
+    rows[i] = mask;
+    features.fills[i] = (int8_t) __builtin_popcountll(after);
+    //only the columns of the cells that changed are updated
+    for (uint64_t changed = before ^ after; changed; changed &= changed - 1) {
+        int j = __builtin_ctzll(changed);
+        typename features_type::column_type& column = features.columns[j];
+        int h = features.heights[j];
+        features.holes -= h - __builtin_popcountll(column);
+        column ^= (typename features_type::column_type) 1 << i;
+        h = column ? height() - __builtin_ctzll(column) : 0;
+        features.holes += h - __builtin_popcountll(column);
+        features.aggregate_height += h - features.heights[j];
+        features.heights[j] = (int8_t) h;
+    }
+}
+
+template <int Rows, int Cols>
+vec4 BasicTetrisGame<Rows, Cols>::get_color(int i, int j) {
+    if (covers(i, j)) {
+        return current_c;
+    }
+    return field_row(i)[j];
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::is_border(int i, int j) {
+    return (j == 0 || j == width() - 1);
+}
+
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::drop() {
     ProcessResult result;
     while ((result = process()) == MOVE);
     return result;
 }
 
-void TetrisGame::debug() {
-    for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::debug() {
+    for (int i = 0; i < height(); ++i) {
         std::cout << "x" << " | ";
-        for (int j = 0; j < GAME_FIELD_COLS; ++j) {
+        for (int j = 0; j < width(); ++j) {
             std::cout << (!is_free(i, j)) << " ";
         }
         std::cout << std::endl;
@@ -145,97 +208,492 @@ void TetrisGame::debug() {
     std::cout << std::endl;
 }
 
-bool TetrisGame::spawn() {
-    int i = rnd_provider->next_int(figures.size());
-    assert(figures.count(i) == 1);
-    current_f = figures[i];
-    int gsize_2 = GEOMETRY_SIZE / 2;
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::spawn() {
+    if (!rnd_provider) {
+        const queued_piece& p = pieces.next();
+        current_f = &FigureTable::find_shape(p.figure);
+        current_c = vec4(0.0f, 0.0f, 0.0f, p.tint);
+    } else {
+        //next_int draws from 1 up to the limit excluded
+        int i = rnd_provider->next_int(FIGURE_COUNT + 1);
+        current_f = &FigureTable::find_shape(i);
+        current_c = vec4(
+                rnd_provider->next_float(0.0f),
+                rnd_provider->next_float(0.0f),
+                rnd_provider->next_float(0.0f),
+                rnd_provider->next_float(9.0f)
+                );
+    }
     current_t = 0;
     current_i = 0;
-    current_j = 1 + GAME_FIELD_COLS / 2 - gsize_2;
-    current_c = vec4(
-            rnd_provider->next_float(0.0f),
-            rnd_provider->next_float(0.0f),
-            rnd_provider->next_float(0.0f),
-            rnd_provider->next_float(9.0f)
-            );
-    geometry g = current_f->find_geometry(current_t);
+    current_j = SPAWN_COL_OF(width());
     return move(0, 0, false, false);
 }
 
-bool TetrisGame::move_left() {
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::move_left() {
     return move(0, -1);
 }
 
-bool TetrisGame::move_right() {
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::move_right() {
     return move(0, 1);
 }
 
-int TetrisGame::destroy() {
-    int count = 0;
-    for (int i = GAME_FIELD_ROWS - 1; i >= 0; --i) {
-        bool ready = 1;
-        for (int j = 0; j < GAME_FIELD_COLS; ++j) {
-            ready &= !is_free(i, j);
-            if (!ready) {
-                break;
-            }
-        }
-        if (ready) {
-            for (int j = i; j > 0; --j) {
-                for (int f = 0; f < GAME_FIELD_COLS; ++f) {
-                    field[j][f] = field[j - 1][f];
-                }
-            }
-            count++;
+template <int Rows, int Cols>
+uint64_t BasicTetrisGame<Rows, Cols>::destroy(uint64_t full) {
+    if (!full) {
+        return 0;
+    }
+    //one pass from the lowest full row up, every row above it moves once
+    int top = height() - features.max_height();
+    int to = 63 - __builtin_clzll(full);
+    for (int from = to - 1; from >= top; --from) {
+        if (full >> from & 1) {
+            continue;
         }
-
+        set_row(to, rows[from]);
+        std::copy(field_row(from), field_row(from) + width(), field_row(to));
+        to--;
     }
-    if (count > 0) {
-        count += destroy();
+    for (; to >= top; --to) {
+        clear_row(to);
     }
-    return count;
+    return full;
 }
 
-ProcessResult TetrisGame::process() {
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::process() {
     ProcessResult result = MOVE;
     if (!move(1, 0)) {
-        result = DROP;
-        int destroyed = destroy();
-        if (destroyed) {
-            result = DESTROY;
+        uint64_t full = 0;
+        if (current_f) {
+            full = lock();
         }
-        if (!spawn()) {
-            result = GAME_OVER;
-            current_f = 0;
+        result = settle(full);
+    }
+    return result;
+}
+
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::settle(uint64_t full) {
+    ProcessResult result = DROP;
+    //rows from the top of the stack down to the lowest full one move, they are recorded whole
+    int top = height() - features.max_height();
+    int bottom = full ? 63 - __builtin_clzll(full) : -1;
+    if (recording && current_f) {
+        recording->locked = (int8_t) FigureTable::find_id(current_f);
+        recording->locked_rotation = current_t;
+        recording->locked_row = (int8_t) current_i;
+        recording->locked_col = (int8_t) current_j;
+    }
+    if (events && current_f) {
+        publish(EVENT_LOCKED);
+    }
+    if (recording) {
+        recording->cleared = full;
+        //the locked figure was not there before the call, unless it did not move
+        for (int i = top; i <= bottom; ++i) {
+            recording->touch(i);
+            recording->vacated[i] |= rows[i] & cells_row() & ~figure_row(i);
+        }
+    }
+    cleared_rows = destroy(full);
+    if (recording) {
+        for (int i = top; i <= bottom; ++i) {
+            recording->occupied[i] = rows[i] & cells_row();
+        }
+    }
+    if (cleared_rows) {
+        result = DESTROY;
+        score += __builtin_popcountll(cleared_rows);
+        if (events) {
+            publish(EVENT_CLEARED, cleared_rows);
         }
     }
+    if (!spawn()) {
+        result = GAME_OVER;
+        current_f = 0;
+    } else if (recording) {
+        recording->spawned = (int8_t) FigureTable::find_id(current_f);
+    }
+    if (events) {
+        publish(result == GAME_OVER ? EVENT_GAME_OVER : EVENT_SPAWNED);
+    }
     return result;
 }
 
-bool TetrisGame::is_free(int i, int j) {
-    return field[i][j] == glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::process(tick_result& out) {
+    begin_recording(out);
+    ProcessResult result = process();
+    end_recording(result, true);
+    return result;
 }
 
-bool TetrisGame::is_clean() {
-    for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
-        for (int j = 0; j < GAME_FIELD_COLS; ++j) {
-            if (!is_free(i, j)) {
-                return false;
-            }
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::drop(tick_result& out) {
+    begin_recording(out);
+    ProcessResult result = drop();
+    end_recording(result, true);
+    return result;
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::rotate(tick_result& out) {
+    begin_recording(out);
+    bool moved = rotate();
+    end_recording(MOVE, moved);
+    return moved;
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::move_left(tick_result& out) {
+    begin_recording(out);
+    bool moved = move_left();
+    end_recording(MOVE, moved);
+    return moved;
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::move_right(tick_result& out) {
+    begin_recording(out);
+    bool moved = move_right();
+    end_recording(MOVE, moved);
+    return moved;
+}
+
+template <int Rows, int Cols>
+typename BasicTetrisGame<Rows, Cols>::row_type BasicTetrisGame<Rows, Cols>::figure_row(int i) const {
+    int r = i - current_i;
+    if (!current_f || r < 0 || r >= GEOMETRY_SIZE) {
+        return 0;
+    }
+    return (row_type) ((row_type) current_f->rotations[(int) current_t].rows[r] << current_j);
+}
+
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::record_figure(uint64_t* cells) {
+    for (int i = std::max(current_i, 0); current_f && i < current_i + GEOMETRY_SIZE; ++i) {
+        if (figure_row(i)) {
+            recording->touch(i);
+            cells[i] |= figure_row(i);
         }
     }
-    return true;
 }
 
-void TetrisGame::addGameOverCb(game_over_cb cb) {
-    game_over_callbacks.push_back(cb);
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::begin_recording(tick_result& out) {
+    out.changed_rows = 0;
+    out.cleared = 0;
+    out.locked = 0;
+    out.locked_rotation = 0;
+    out.locked_row = 0;
+    out.locked_col = 0;
+    out.spawned = 0;
+    recording = &out;
+    record_figure(out.vacated);
+}
+
+//a cell both vacated and occupied, like one the figure moved within, did not change
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::end_recording(ProcessResult result, bool moved) {
+    tick_result& out = *recording;
+    record_figure(out.occupied);
+    for (uint64_t rest = out.changed_rows; rest; rest &= rest - 1) {
+        int i = __builtin_ctzll(rest);
+        uint64_t same = out.vacated[i] & out.occupied[i];
+        out.vacated[i] ^= same;
+        out.occupied[i] ^= same;
+        if (!out.vacated[i] && !out.occupied[i]) {
+            out.changed_rows &= ~(1ull << i);
+        }
+    }
+    out.result = result;
+    out.moved = moved;
+    recording = 0;
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::is_free(int i, int j) {
+    return !(rows[i] >> j & 1) && !covers(i, j);
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::is_clean() {
+    row_type field_mask = (row_type) (width() == 64 ? ~0ull : (1ull << width()) - 1);
+    for (int i = 0; i < height(); ++i) {
+        if (rows[i] & field_mask) {
+            return false;
+        }
+    }
+    return !current_f;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_score() {
+    return score;
 }
 
-bool TetrisGame::contains_pair(std::vector<int_pair>& pairs, int i, int j) {
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::set_events(EventBus* bus) {
+    events = bus;
+}
+
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::publish(GameEventType type, uint64_t cleared) {
+    game_event e;
+    e.type = (uint8_t) type;
+    e.figure = current_f ? (int8_t) FigureTable::find_id(current_f) : 0;
+    e.rotation = current_t;
+    e.row = (int8_t) current_i;
+    e.col = (int8_t) current_j;
+    e.score = score;
+    e.rows = cleared;
+    events->publish(e);
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::contains_pair(std::vector<int_pair>& pairs, int i, int j) {
     return 1 == count_if(pairs.begin(), pairs.end(), [i, j](int_pair & p) {
         return p.first == i && p.second == j;
     });
 }
 
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_field_rows() const {
+    return height();
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_field_cols() const {
+    return width();
+}
+
+template <int Rows, int Cols>
+const typename BasicTetrisGame<Rows, Cols>::row_type* BasicTetrisGame<Rows, Cols>::get_rows() const {
+    return rows;
+}
+
+template <int Rows, int Cols>
+const figure_shape* BasicTetrisGame<Rows, Cols>::get_figure() const {
+    return current_f;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_rotation() const {
+    return current_t;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_row() const {
+    return current_i;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_col() const {
+    return current_j;
+}
+
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::apply(const placement& p) {
+    assert(current_f);
+    return apply(p, current_f);
+}
+
+template <int Rows, int Cols>
+ProcessResult BasicTetrisGame<Rows, Cols>::apply(const placement& p, const figure_shape* figure) {
+    assert(figure);
+    journal_entry e;
+    e.figure = current_f;
+    e.color = current_c;
+    if (rnd_provider) {
+        rnd_provider->save(e.rng);
+    } else {
+        e.rng.words[0] = pieces.position();
+    }
+    e.rotation = current_t;
+    e.row = (int8_t) current_i;
+    e.col = (int8_t) current_j;
+    e.placed = p;
+    e.locked = figure;
+    e.score = score;
+    e.cleared = 0;
+    e.last_cleared = cleared_rows;
+
+    current_f = figure;
+    current_t = p.rotation;
+    current_i = p.row;
+    current_j = p.col;
+    e.cleared = lock();
+    for (uint64_t rest = e.cleared; rest; rest &= rest - 1) {
+        int i = __builtin_ctzll(rest);
+        journal_colors.insert(journal_colors.end(), field_row(i), field_row(i) + width());
+    }
+    journal.push_back(e);
+    return settle(e.cleared);
+}
+
+template <int Rows, int Cols>
+bool BasicTetrisGame<Rows, Cols>::undo() {
+    if (journal.empty()) {
+        return false;
+    }
+    const journal_entry& e = journal.back();
+    //put the cleared rows back in between the rows that fell down
+    if (e.cleared) {
+        int below = __builtin_popcountll(e.cleared);
+        size_t size = journal_colors.size() - below * width();
+        const vec4* colors = &journal_colors[size];
+        for (int i = 0; i < height(); ++i) {
+            if (e.cleared >> i & 1) {
+                set_row(i, (row_type) ~0);
+                std::copy(colors, colors + width(), field_row(i));
+                colors += width();
+                below--;
+            } else {
+                set_row(i, rows[i + below]);
+                std::copy(field_row(i + below), field_row(i + below) + width(), field_row(i));
+            }
+        }
+        journal_colors.resize(size);
+    }
+    const geometry_mask& geo = e.locked->rotations[(int) e.placed.rotation];
+    for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+        if (!geo.rows[r]) {
+            continue;
+        }
+        set_row(e.placed.row + r, rows[e.placed.row + r] & (row_type) ~((row_type) geo.rows[r] << e.placed.col));
+        for (int c = 0; c < GEOMETRY_SIZE; ++c) {
+            if (geo.rows[r] >> c & 1) {
+                field_row(e.placed.row + r)[e.placed.col + c] = vec4(0.0f, 0.0f, 0.0f, 0.0f);
+            }
+        }
+    }
+    current_f = e.figure;
+    current_c = e.color;
+    current_t = e.rotation;
+    current_i = e.row;
+    current_j = e.col;
+    score = e.score;
+    cleared_rows = e.last_cleared;
+    if (rnd_provider) {
+        rnd_provider->restore(e.rng);
+    } else {
+        pieces.rewind(e.rng.words[0]);
+    }
+    journal.pop_back();
+    return true;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::journal_size() const {
+    return journal.size();
+}
+
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::save(game_state& state) const {
+    for (int i = 0; i < height(); ++i) {
+        state.rows[i] = rows[i];
+    }
+    state.figure = current_f ? (int8_t) FigureTable::find_id(current_f) : 0;
+    state.rotation = current_t;
+    state.row = (int8_t) current_i;
+    state.col = (int8_t) current_j;
+    state.score = score;
+    state.position = rnd_provider ? 0 : pieces.position();
+}
+
+template <int Rows, int Cols>
+void BasicTetrisGame<Rows, Cols>::restore(const game_state& state) {
+    assert(!rnd_provider && state.position > 0);
+    journal.clear();
+    journal_colors.clear();
+    for (int i = 0; i < height(); ++i) {
+        clear_row(i);
+        set_row(i, (row_type) state.rows[i] | empty_row());
+    }
+    pieces.rewind(state.position);
+    current_f = state.figure ? &FigureTable::find_shape(state.figure) : 0;
+    current_c = vec4(0.0f, 0.0f, 0.0f, pieces.at(state.position - 1).tint);
+    current_t = state.rotation;
+    current_i = state.row;
+    current_j = state.col;
+    score = state.score;
+    cleared_rows = 0;
+}
+
+template <int Rows, int Cols>
+uint64_t BasicTetrisGame<Rows, Cols>::get_cleared() const {
+    return cleared_rows;
+}
+
+template <int Rows, int Cols>
+const typename BasicTetrisGame<Rows, Cols>::features_type& BasicTetrisGame<Rows, Cols>::get_features() const {
+    return features;
+}
+
+template <int Rows, int Cols>
+int BasicTetrisGame<Rows, Cols>::get_preview(const figure_shape** out, int capacity) const {
+    if (rnd_provider) {
+        return 0;
+    }
+    int count = std::min(capacity, pieces.preview_size());
+    for (int k = 0; k < count; ++k) {
+        out[k] = &FigureTable::find_shape(pieces.peek(k).figure);
+    }
+    return count;
+}
+
+template <int Rows, int Cols>
+uint64_t BasicTetrisGame<Rows, Cols>::get_board_hash() const {
+    return board_key;
+}
+
+template <int Rows, int Cols>
+uint64_t BasicTetrisGame<Rows, Cols>::get_hash() const {
+    if (!current_f) {
+        return board_key;
+    }
+    return board_key ^ Zobrist::piece_key(FigureTable::find_id(current_f), current_t, current_i, current_j);
+}
+
+//every bit outside of the playable columns is occupied, so a full row is all ones
+template <int Rows, int Cols>
+typename BasicTetrisGame<Rows, Cols>::row_type BasicTetrisGame<Rows, Cols>::empty_row() const {
+    return (row_type) ~cells_row();
+}
+
+template <int Rows, int Cols>
+typename BasicTetrisGame<Rows, Cols>::row_type BasicTetrisGame<Rows, Cols>::cells_row() const {
+    return (row_type) (((1ull << (width() - 1)) - 1) & ~1ull);
+}
+
+template <int Rows, int Cols>
+int basic_board_features<Rows, Cols>::max_height() const {
+    return *std::max_element(heights, heights + width);
+}
+
+template <int Rows, int Cols>
+int basic_board_features<Rows, Cols>::bumpiness() const {
+    int sum = 0;
+    for (int j = 1; j + 2 < width; ++j) {
+        sum += std::abs(heights[j] - heights[j + 1]);
+    }
+    return sum;
+}
 
+//the default well, a 10 columns wide well as 12 with the borders
+template struct basic_board_features<GAME_FIELD_ROWS, GAME_FIELD_COLS>;
+template class BasicTetrisGame<GAME_FIELD_ROWS, GAME_FIELD_COLS>;
+//16 and 40 columns wide wells
+template struct basic_board_features<GAME_FIELD_ROWS, 18>;
+template class BasicTetrisGame<GAME_FIELD_ROWS, 18>;
+template struct basic_board_features<GAME_FIELD_ROWS, 42>;
+template class BasicTetrisGame<GAME_FIELD_ROWS, 42>;
+//tall stress well
+template struct basic_board_features<42, GAME_FIELD_COLS>;
+template class BasicTetrisGame<42, GAME_FIELD_COLS>;
+template struct basic_board_features<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+template class BasicTetrisGame<DYNAMIC_SIZE, DYNAMIC_SIZE>;
@@ -1,17 +1,32 @@
 #pragma once 
 
 #include <map>
+#include <vector>
+#include <type_traits>
 #include "glm/glm.hpp"
-#include "figures/AbstractFigure.h"
+#include "figures/FigureTable.h"
 #include "RandomNumberProvider.h"
+#include "PieceQueue.h"
+#include "Zobrist.h"
+#include "EventBus.h"
 
 #define GAME_FIELD_COLS 12
 #define GAME_FIELD_ROWS 22
+//bumped by every change that makes the same inputs play out differently, see Replay.h
+#define ENGINE_VERSION 1
+
+//every bit outside of the playable columns is occupied, so a full row is all ones
+#define FULL_ROW_MASK ((row_mask) ~0)
+#define FIELD_ROW_MASK ((row_mask) ((1 << GAME_FIELD_COLS) - 1))
+#define EMPTY_ROW_MASK ((row_mask) ~(FIELD_ROW_MASK & ~1 & ~(1 << (GAME_FIELD_COLS - 1))))
+#define CELLS_ROW_MASK ((row_mask) ~EMPTY_ROW_MASK)
+//column a new figure appears at in a well `cols` wide, in rotation 0 on the top row
+#define SPAWN_COL_OF(cols) (1 + (cols) / 2 - GEOMETRY_SIZE / 2)
+#define SPAWN_COL SPAWN_COL_OF(GAME_FIELD_COLS)
 
 using glm::vec4;
 
 typedef std::pair<int, int> int_pair;
-typedef void (*game_over_cb)();
 
 enum ProcessResult {
     MOVE,
@@ -20,38 +35,295 @@ enum ProcessResult {
     GAME_OVER
 };
 
-class TetrisGame {
+//one player input, in terms of the TetrisGame method it maps to
+enum GameInput {
+    INPUT_ROTATE,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    //process(), gravity moves the figure one row down
+    INPUT_DOWN,
+    INPUT_DROP
+};
+
+//where the falling figure ends up locked, in TetrisGame coordinates
+struct placement {
+    int8_t rotation;
+    int8_t row;
+    int8_t col;
+    //search state the placement was reached from, see PlacementFinder::inputs
+    uint16_t state;
+};
+
+//a BasicTetrisGame dimension given to the constructor instead of the template
+#define DYNAMIC_SIZE 0
+//largest wells, every row and every column has to fit in 64 bits
+#define MAX_FIELD_ROWS 64
+#define MAX_FIELD_COLS 64
+
+/*
+ Types of a well `Rows` x `Cols` big, border columns included. Rows are the
+ narrowest masks that fit a whole row, columns the narrowest masks that fit
+ a whole column. Dynamic dimensions take the widest ones.
+ */
+template <int Rows, int Cols>
+struct well_traits {
+    typedef typename std::conditional<Cols != DYNAMIC_SIZE && Cols <= 16, uint16_t,
+            typename std::conditional<Cols != DYNAMIC_SIZE && Cols <= 32, uint32_t, uint64_t>::type>::type row_type;
+    typedef typename std::conditional<Rows != DYNAMIC_SIZE && Rows <= 32, uint32_t, uint64_t>::type column_type;
+
+    static const int rows_capacity = Rows != DYNAMIC_SIZE ? Rows : MAX_FIELD_ROWS;
+    static const int cols_capacity = Cols != DYNAMIC_SIZE ? Cols : MAX_FIELD_COLS;
+
+    static_assert(rows_capacity <= MAX_FIELD_ROWS && cols_capacity <= MAX_FIELD_COLS, "well is too big");
+};
+
+//occupancy statistics of the locked cells, kept up to date by every row write
+template <int Rows, int Cols>
+struct basic_board_features {
+    typedef typename well_traits<Rows, Cols>::column_type column_type;
+
+    //bit i is set when row i of the column is taken
+    column_type columns[well_traits<Rows, Cols>::cols_capacity];
+    //rows from the floor up to the highest taken cell, 0 for empty and border columns
+    int8_t heights[well_traits<Rows, Cols>::cols_capacity];
+    //taken playable cells per row
+    int8_t fills[well_traits<Rows, Cols>::rows_capacity];
+    //empty cells under a taken cell of the same column
+    int holes;
+    int aggregate_height;
+    //columns of the well, borders included
+    int width;
+
+    int max_height() const;
+    //sum of the height differences of neighbouring columns
+    int bumpiness() const;
+};
+
+typedef basic_board_features<GAME_FIELD_ROWS, GAME_FIELD_COLS> board_features;
+
+//what apply() changed, enough for undo() to put it back
+struct journal_entry {
+    const figure_shape* figure;
+    vec4 color;
+    rng_state rng;
+    int8_t rotation;
+    int8_t row;
+    int8_t col;
+    //where the figure was locked, and which one
+    placement placed;
+    const figure_shape* locked;
+    //rows cleared by the placement, as indexes before the clear
+    uint64_t cleared;
+    //get_cleared() before the placement
+    uint64_t last_cleared;
+    int score;
+};
+
+/*
+ What one call of the game changed, filled by the overloads of process(),
+ drop() and the moves that take one, so that a view of the well can be
+ updated without looking at every cell.
+
+ Cells count as taken when they are locked or covered by the falling
+ figure, masks are in get_rows() coordinates. Only the rows of
+ `changed_rows` are written, the others keep whatever they held.
+ */
+struct tick_result {
+    ProcessResult result;
+    //the move was possible, always true for process() and drop()
+    bool moved;
+    //bit i for every row i with a cell that changed
+    uint64_t changed_rows;
+    //cells that became free, by row
+    uint64_t vacated[MAX_FIELD_ROWS];
+    //cells that became taken, by row
+    uint64_t occupied[MAX_FIELD_ROWS];
+    //rows cleared, bit i for row i before the clear
+    uint64_t cleared;
+    //FigureTable id of the figure locked by the call, 0 when none was
+    int8_t locked;
+    int8_t locked_rotation;
+    int8_t locked_row;
+    int8_t locked_col;
+    //FigureTable id of the figure spawned by the call, 0 when none was; a failed spawn is GAME_OVER
+    int8_t spawned;
+
+    //starts row i over unless it is already part of the result
+    void touch(int i) {
+        if (!(changed_rows >> i & 1)) {
+            changed_rows |= 1ull << i;
+            vacated[i] = 0;
+            occupied[i] = 0;
+        }
+    }
+};
+
+//what a game plays on from, see BasicTetrisGame::save
+struct game_state {
+    //locked cells, one mask per row as get_rows() has them
+    uint64_t rows[MAX_FIELD_ROWS];
+    //FigureTable id of the falling figure, 0 once the game is over
+    int8_t figure;
+    int8_t rotation;
+    int8_t row;
+    int8_t col;
+    int score;
+    //pieces taken from the piece queue, the falling one included
+    uint64_t position;
+};
+
+/*
+ The game on a well `Rows` x `Cols` big, border columns included.
+
+ Dimensions are template arguments so that the loops over the well get
+ unrolled for the common sizes, see the instantiations at the end of
+ TetrisGame.cpp. A DYNAMIC_SIZE dimension is given to the constructor
+ instead and can be anything up to MAX_FIELD_ROWS x MAX_FIELD_COLS.
+ */
+template <int Rows, int Cols>
+class BasicTetrisGame {
 public:
-    TetrisGame(RandomNumberProvider* provider);
-    virtual ~TetrisGame();
+    typedef typename well_traits<Rows, Cols>::row_type row_type;
+    typedef basic_board_features<Rows, Cols> features_type;
+
+    //figures and colours come from `pieces`, the fast path without virtual calls
+    BasicTetrisGame(const PieceQueue& pieces, int rows = Rows, int cols = Cols);
+    BasicTetrisGame(RandomNumberProvider* provider, int rows = Rows, int cols = Cols);
+    virtual ~BasicTetrisGame();
 
     virtual ProcessResult process();
     virtual ProcessResult drop();
     virtual bool rotate();
     virtual bool move_left();
     virtual bool move_right();
+    //the same, telling what changed in `out`
+    ProcessResult process(tick_result& out);
+    ProcessResult drop(tick_result& out);
+    bool rotate(tick_result& out);
+    bool move_left(tick_result& out);
+    bool move_right(tick_result& out);
     virtual bool is_free(int, int);
     virtual vec4 get_color(int, int);
     virtual bool is_clean();
     virtual bool is_border(int, int);    
     virtual void debug();
-    virtual void addGameOverCb(game_over_cb cb);
+    //publishes the spawns, locks, clears and the game over to `bus`, null stops it
+    void set_events(EventBus* bus);
+    virtual int get_score();
     bool contains_pair(std::vector<int_pair>&, int, int);    
+    int get_field_rows() const;
+    int get_field_cols() const;
+    //occupancy of the locked cells, followed by the solid floor rows
+    const row_type* get_rows() const;
+    //falling figure, null once the game is over
+    const figure_shape* get_figure() const;
+    int get_rotation() const;
+    int get_row() const;
+    int get_col() const;
+    /*
+     Figures coming after the falling one, as far as the piece queue shows
+     them. A game on a RandomNumberProvider has no preview.
+
+     @result the number of figures written to `out`
+     */
+    int get_preview(const figure_shape** out, int capacity) const;
+    //zobrist hash of the locked cells and the falling figure, see Zobrist.h
+    uint64_t get_hash() const;
+    //the same of the locked cells alone
+    uint64_t get_board_hash() const;
+    const features_type& get_features() const;
+    //rows cleared when the last figure was locked, bit i for row i before the clear
+    uint64_t get_cleared() const;
+
+    /*
+     Locks the falling figure at `p` as if it was moved there and dropped,
+     then clears rows and spawns the next figure. `p` must be reachable, as
+     reported by PlacementFinder.
+
+     The change is journaled, undo() reverts the last applied placement
+     including the figure generator, so a search can walk the game tree
+     without copying it.
+     */
+    virtual ProcessResult apply(const placement& p);
+    //the same with `figure` in place of the falling one, for searches over figures not dealt yet
+    ProcessResult apply(const placement& p, const figure_shape* figure);
+    virtual bool undo();
+    int journal_size() const;
+
+    void save(game_state& state) const;
+    /*
+     Puts the game in a state saved from a game on the same piece queue. The
+     colours of the locked cells are not part of the state, they come back
+     blank, and the journal is dropped. Only for games on a piece queue.
+     */
+    void restore(const game_state& state);
 private:
+    typedef well_traits<Rows, Cols> traits;
+
+    //null when the game plays from the piece queue
     RandomNumberProvider* rnd_provider;
-    std::map<int, AbstractFigure*> figures;
-    std::vector<game_over_cb> game_over_callbacks;
-    AbstractFigure* current_f;
+    PieceQueue pieces;
+    //sizes of the dynamic dimensions, the template ones otherwise
+    int field_rows;
+    int field_cols;
+    EventBus* events;
+    const figure_shape* current_f;
     int current_i;
     int current_j;
     vec4 current_c;
     char current_t;
-    vec4 field[GAME_FIELD_ROWS][GAME_FIELD_COLS];
+    int score;
+    uint64_t cleared_rows;
+    //occupancy of the locked cells, one mask per row plus a solid floor below the well
+    row_type rows[traits::rows_capacity + GEOMETRY_SIZE];
+    //hash of the locked cells, kept in step with rows by set_row
+    uint64_t board_key;
+    features_type features;
+    //colours of the cells, row after row
+    vec4 field[traits::rows_capacity * traits::cols_capacity];
+    std::vector<journal_entry> journal;
+    //colours of the rows cleared by journaled placements, top row first
+    std::vector<vec4> journal_colors;
+    //result of the call in progress, null when the caller did not ask for one
+    tick_result* recording;
     
-    virtual int destroy();
-    virtual int calc_height(geometry & geo);
+    virtual ProcessResult settle(uint64_t full);
+    //removes the `full` rows in one compaction pass and returns them
+    virtual uint64_t destroy(uint64_t full);
     virtual void init_field();
+    virtual void clear_row(int);
+    void set_row(int, row_type);
+    //returns the rows the figure completed, bit i for row i
+    virtual uint64_t lock();
+    bool collides(const geometry_mask&, int, int);
+    bool covers(int, int);
     virtual bool move(int, int, bool dt = false, bool spawned = true);
     virtual bool spawn();
+    void init(int rows, int cols);
+    //cells of the falling figure on row i
+    row_type figure_row(int i) const;
+    //adds the cells of the falling figure to `cells` of the recorded result
+    void record_figure(uint64_t* cells);
+    void publish(GameEventType type, uint64_t cleared = 0);
+    void begin_recording(tick_result& out);
+    void end_recording(ProcessResult result, bool moved);
+
+    //the template dimensions when they are given, so that loops over them unroll
+    int height() const {
+        return Rows != DYNAMIC_SIZE ? Rows : field_rows;
+    }
+
+    int width() const {
+        return Cols != DYNAMIC_SIZE ? Cols : field_cols;
+    }
+
+    vec4* field_row(int i) {
+        return field + i * width();
+    }
+
+    row_type empty_row() const;
+    row_type cells_row() const;
 };
 
+typedef BasicTetrisGame<GAME_FIELD_ROWS, GAME_FIELD_COLS> TetrisGame;
+typedef BasicTetrisGame<DYNAMIC_SIZE, DYNAMIC_SIZE> DynamicTetrisGame;
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::Job::~Job() {
+}
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    this->threads = threads;
+    this->ranges = new Range[threads];
+    this->job = 0;
+    this->grain = 1;
+    this->generation = 0;
+    this->active = 0;
+    this->stopping = false;
+    for (int i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto & w : workers) {
+        w.join();
+    }
+    delete[] ranges;
+}
+
+int ThreadPool::size() const {
+    return threads;
+}
+
+void ThreadPool::run(Job& job, int begin, int end, int grain) {
+    if (begin >= end) {
+        return;
+    }
+    int count = end - begin;
+    for (int i = 0; i < threads; ++i) {
+        std::lock_guard<std::mutex> guard(ranges[i].lock);
+        ranges[i].begin = begin + (int) ((long long) count * i / threads);
+        ranges[i].end = begin + (int) ((long long) count * (i + 1) / threads);
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->job = &job;
+        this->grain = std::max(1, grain);
+        this->active = threads - 1;
+        generation++;
+    }
+    wake.notify_all();
+    execute(0);
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this]() {
+        return active == 0;
+    });
+    this->job = 0;
+}
+
+void ThreadPool::work(int worker) {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this, seen]() {
+                return stopping || generation != seen;
+            });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        execute(worker);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            active--;
+        }
+        done.notify_one();
+    }
+}
+
+void ThreadPool::execute(int worker) {
+    int begin, end;
+    while (pop(worker, begin, end) || steal(worker, begin, end)) {
+        job->run(begin, end, worker);
+    }
+}
+
+bool ThreadPool::pop(int worker, int& begin, int& end) {
+    Range& r = ranges[worker];
+    std::lock_guard<std::mutex> guard(r.lock);
+    if (r.begin >= r.end) {
+        return false;
+    }
+    begin = r.begin;
+    end = std::min(r.begin + grain, r.end);
+    r.begin = end;
+    return true;
+}
+
+bool ThreadPool::steal(int worker, int& begin, int& end) {
+    for (int k = 1; k < threads; ++k) {
+        Range& victim = ranges[(worker + k) % threads];
+        int from, to;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            int left = victim.end - victim.begin;
+            if (left <= 0) {
+                continue;
+            }
+            from = left > grain ? victim.begin + left / 2 : victim.begin;
+            to = victim.end;
+            victim.end = from;
+        }
+        {
+            Range& own = ranges[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            own.begin = from;
+            own.end = to;
+        }
+        return pop(worker, begin, end);
+    }
+    return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ Fixed set of worker threads running index ranges with work stealing.
+
+ Every run splits [begin, end) evenly between the workers. A worker takes
+ `grain` sized chunks from the front of its own range and, once it is empty,
+ steals the back half of another worker's range. The calling thread works
+ as worker 0, so a pool of one thread runs everything inline.
+ */
+class ThreadPool {
+public:
+
+    class Job {
+    public:
+        virtual ~Job();
+        virtual void run(int begin, int end, int worker) = 0;
+    };
+
+    ThreadPool(int threads = 0);
+    virtual ~ThreadPool();
+
+    int size() const;
+    void run(Job& job, int begin, int end, int grain = 1);
+
+    template <class F>
+    void parallel_for(int begin, int end, int grain, F f) {
+        FunctionJob<F> job(f);
+        run(job, begin, end, grain);
+    }
+
+private:
+
+    template <class F>
+    class FunctionJob : public Job {
+    public:
+        FunctionJob(F& f) : f(f) {
+        }
+        virtual void run(int begin, int end, int worker) {
+            f(begin, end, worker);
+        }
+    private:
+        F& f;
+    };
+
+    //padded so that workers never share a cache line
+    struct Range {
+        std::mutex lock;
+        int begin;
+        int end;
+        char padding[64];
+    };
+
+    int threads;
+    Range* ranges;
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Job* job;
+    int grain;
+    unsigned generation;
+    int active;
+    bool stopping;
+
+    void work(int worker);
+    void execute(int worker);
+    bool pop(int worker, int& begin, int& end);
+    bool steal(int worker, int& begin, int& end);
+
+    //copying disabled
+    ThreadPool(const ThreadPool&);
+    const ThreadPool& operator=(const ThreadPool&);
+};
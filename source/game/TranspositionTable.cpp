@@ -0,0 +1,148 @@
+#include <new>
+
+#include "TranspositionTable.h"
+
+#define CACHE_LINE 64
+
+TranspositionTable::TranspositionTable(int megabytes, ReplacePolicy policy) {
+    static_assert(sizeof(Bucket) == CACHE_LINE, "bucket must fill one cache line");
+    static_assert(sizeof(Counters) == CACHE_LINE, "counters must fill one cache line");
+    uint64_t count = 1;
+    uint64_t limit = (uint64_t) (megabytes > 0 ? megabytes : 1) * 1024 * 1024 / sizeof(Bucket);
+    while (count * 2 <= limit) {
+        count *= 2;
+    }
+    this->policy = policy;
+    this->mask = count - 1;
+    this->memory = new char[count * sizeof(Bucket) + CACHE_LINE];
+    uintptr_t aligned = ((uintptr_t) memory + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1);
+    this->buckets = new((void*) aligned) Bucket[count];
+    this->generation = 1;
+    clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+    //slots are trivially destructible
+    delete[] memory;
+}
+
+bool TranspositionTable::probe(uint64_t key, tt_entry& entry) {
+    Bucket& b = bucket(key);
+    for (int s = 0; s < 4; ++s) {
+        uint64_t data = b.slots[s].data.load(std::memory_order_relaxed);
+        uint64_t check = b.slots[s].check.load(std::memory_order_relaxed);
+        if (data && (check ^ data) == key) {
+            entry = unpack(data);
+            counter(key).hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    counter(key).misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const tt_entry& entry) {
+    Bucket& b = bucket(key);
+    uint8_t current = generation.load(std::memory_order_relaxed);
+    int victim = -1;
+    bool victim_current = true;
+    int victim_depth = 0;
+    for (int s = 0; s < 4; ++s) {
+        uint64_t data = b.slots[s].data.load(std::memory_order_relaxed);
+        uint64_t check = b.slots[s].check.load(std::memory_order_relaxed);
+        if (!data || (check ^ data) == key) {
+            victim = s;
+            victim_current = false;
+            break;
+        }
+        //stale entries go first, then the shallowest ones
+        bool is_current = generation_of(data) == current;
+        int depth = depth_of(data);
+        if (victim < 0 || (victim_current && !is_current)
+                || (victim_current == is_current && depth < victim_depth)) {
+            victim = s;
+            victim_current = is_current;
+            victim_depth = depth;
+        }
+    }
+    Counters& c = counter(key);
+    uint64_t old = b.slots[victim].data.load(std::memory_order_relaxed);
+    if (old && (b.slots[victim].check.load(std::memory_order_relaxed) ^ old) != key) {
+        if (policy == REPLACE_DEPTH && victim_current && victim_depth > entry.depth) {
+            return;
+        }
+        c.replacements.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t data = pack(entry, current);
+    b.slots[victim].data.store(data, std::memory_order_relaxed);
+    b.slots[victim].check.store(key ^ data, std::memory_order_relaxed);
+    c.stores.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (uint64_t i = 0; i <= mask; ++i) {
+        for (int s = 0; s < 4; ++s) {
+            buckets[i].slots[s].check.store(0, std::memory_order_relaxed);
+            buckets[i].slots[s].data.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < STRIPES; ++i) {
+        counters[i].hits = 0;
+        counters[i].misses = 0;
+        counters[i].stores = 0;
+        counters[i].replacements = 0;
+    }
+}
+
+void TranspositionTable::new_search() {
+    //generation 0 is never used, so a packed entry is never 0
+    uint8_t next = generation.load(std::memory_order_relaxed) + 1;
+    generation.store(next ? next : 1, std::memory_order_relaxed);
+}
+
+int64_t TranspositionTable::capacity() const {
+    return (int64_t) (mask + 1) * 4;
+}
+
+tt_stats TranspositionTable::stats() const {
+    tt_stats result = {0, 0, 0, 0};
+    for (int i = 0; i < STRIPES; ++i) {
+        result.hits += counters[i].hits.load(std::memory_order_relaxed);
+        result.misses += counters[i].misses.load(std::memory_order_relaxed);
+        result.stores += counters[i].stores.load(std::memory_order_relaxed);
+        result.replacements += counters[i].replacements.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+TranspositionTable::Bucket& TranspositionTable::bucket(uint64_t key) const {
+    return buckets[key & mask];
+}
+
+TranspositionTable::Counters& TranspositionTable::counter(uint64_t key) {
+    return counters[(key >> 58) & (STRIPES - 1)];
+}
+
+//bits 0..31 value, 32..39 depth, 40..47 generation, 48..63 move
+uint64_t TranspositionTable::pack(const tt_entry& entry, uint8_t generation) {
+    return (uint64_t) (uint32_t) entry.value
+            | (uint64_t) (uint8_t) entry.depth << 32
+            | (uint64_t) generation << 40
+            | (uint64_t) entry.move << 48;
+}
+
+tt_entry TranspositionTable::unpack(uint64_t data) {
+    tt_entry entry;
+    entry.value = (int32_t) (uint32_t) data;
+    entry.depth = (int8_t) (uint8_t) (data >> 32);
+    entry.move = (uint16_t) (data >> 48);
+    return entry;
+}
+
+uint8_t TranspositionTable::generation_of(uint64_t data) {
+    return (uint8_t) (data >> 40);
+}
+
+int TranspositionTable::depth_of(uint64_t data) {
+    return (int8_t) (uint8_t) (data >> 32);
+}
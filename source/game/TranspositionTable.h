@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+enum ReplacePolicy {
+    //a store always takes the slot of its key or the shallowest one
+    REPLACE_ALWAYS,
+    //a store never evicts a deeper entry of the current search
+    REPLACE_DEPTH
+};
+
+struct tt_entry {
+    int32_t value;
+    int8_t depth;
+    uint16_t move;
+};
+
+struct tt_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t replacements;
+};
+
+/*
+ Fixed size hash table of searched positions shared by all the search threads.
+
+ A bucket holds four 16 byte slots and fills exactly one cache line. Slots
+ are written without locks: a slot keeps the data word and the key XORed
+ with it, so a probe that reads halves of two different stores gets a key
+ that does not match and counts as a miss instead of returning torn data.
+
+ Entries of older searches, see new_search(), are always replaceable.
+ */
+class TranspositionTable {
+public:
+    TranspositionTable(int megabytes, ReplacePolicy policy = REPLACE_DEPTH);
+    virtual ~TranspositionTable();
+
+    bool probe(uint64_t key, tt_entry& entry);
+    void store(uint64_t key, const tt_entry& entry);
+    //drops every entry and resets the counters, not thread safe
+    void clear();
+    //marks the entries stored so far as stale
+    void new_search();
+
+    int64_t capacity() const;
+    tt_stats stats() const;
+
+private:
+
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    struct Bucket {
+        Slot slots[4];
+    };
+
+    //counters are striped by key to keep threads off each other's lines
+    struct Counters {
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> stores;
+        std::atomic<uint64_t> replacements;
+        char padding[32];
+    };
+
+    static const int STRIPES = 16;
+
+    ReplacePolicy policy;
+    char* memory;
+    Bucket* buckets;
+    uint64_t mask;
+    std::atomic<uint8_t> generation;
+    Counters counters[STRIPES];
+
+    Bucket& bucket(uint64_t key) const;
+    Counters& counter(uint64_t key);
+
+    static uint64_t pack(const tt_entry& entry, uint8_t generation);
+    static tt_entry unpack(uint64_t data);
+    static uint8_t generation_of(uint64_t data);
+    static int depth_of(uint64_t data);
+
+    //copying disabled
+    TranspositionTable(const TranspositionTable&);
+    const TranspositionTable& operator=(const TranspositionTable&);
+};
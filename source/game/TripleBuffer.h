@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+/*
+ Hands the latest value from one writer thread to one reader thread
+ without locks and without either of them ever waiting.
+
+ The writer fills back(), then publish() swaps it with the middle buffer.
+ read() swaps the middle buffer with the front one when something new was
+ published since, and the front one is left alone until the next read(),
+ so the reader can look at it as long as it likes.
+ */
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), back_index(2), front_index(0) {
+    }
+
+    //writer side
+    T& back() {
+        return buffers[back_index];
+    }
+
+    void publish() {
+        back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+
+    //reader side, the latest published value or the one read before
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front_index = middle.exchange(front_index, std::memory_order_acq_rel) & ~FRESH;
+        }
+        return buffers[front_index];
+    }
+
+private:
+    //set in middle when it holds a value the reader has not taken yet
+    static const int FRESH = 4;
+
+    T buffers[3];
+    std::atomic<int> middle;
+    int back_index;
+    int front_index;
+
+    //copying disabled
+    TripleBuffer(const TripleBuffer&);
+    const TripleBuffer& operator=(const TripleBuffer&);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ Keys of the incremental game hash.
+
+ The hash is the XOR of one key per (row index, row content) and one key per
+ (figure, rotation, row, column) of the falling figure, so changing a row or
+ moving the figure costs two XORs. Keys come out of the splitmix64 finalizer
+ instead of a table: they are the same on every run and every machine, and
+ need no initialisation. An empty row has key 0.
+ */
+namespace Zobrist {
+
+    inline uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    //`cells` are the playable bits of the row, borders masked out
+    inline uint64_t row_key(int i, uint64_t cells) {
+        return cells ? mix(0x9e3779b97f4a7c15ULL * (uint64_t) (i + 1) + cells) : 0;
+    }
+
+    inline uint64_t piece_key(int figure, int rotation, int i, int j) {
+        return mix(0xd1b54a32d192ed03ULL ^ ((uint64_t) figure << 24 | (uint64_t) rotation << 16 | (uint64_t) (i & 0xFF) << 8 | (uint64_t) (j & 0xFF)));
+    }
+}
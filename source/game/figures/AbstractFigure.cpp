@@ -7,3 +7,12 @@ AbstractFigure::AbstractFigure() {
 AbstractFigure::~AbstractFigure() {
 }
 
+void AbstractFigure::init_mask(char i) {
+    geometry& g = geo[i];
+    assert(g.size() <= GEOMETRY_SIZE);
+    row_mask r[GEOMETRY_SIZE];
+    for (int k = 0; k < GEOMETRY_SIZE; ++k) {
+        r[k] = k < (int) g.size() ? (row_mask) g[k].to_ulong() : 0;
+    }
+    shape.rotations[(int) i] = make_geometry_mask(r[0], r[1], r[2], r[3]);
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <bitset>
 #include <map>
+#include <stdint.h>
 #include <assert.h>
 
 #define GEOMETRY_SIZE 4
@@ -10,10 +11,64 @@
 
 typedef std::bitset<GEOMETRY_SIZE> geometry_bits;
 typedef std::vector<geometry_bits> geometry;
+typedef uint16_t row_mask;
+
+//geometry packed into one bit mask per row, bit j is column j of the figure
+struct geometry_mask {
+    row_mask rows[GEOMETRY_SIZE];
+    //bounding box, rows top..height and columns left..right hold all the cells
+    int8_t top;
+    int8_t height;
+    int8_t left;
+    int8_t right;
+    //index of the lowest filled row per column, -1 when the column is empty
+    int8_t floor[GEOMETRY_SIZE];
+};
+
+struct figure_shape {
+    geometry_mask rotations[MAX_ROTATION_INDEX + 1];
+};
+
+constexpr int8_t mask_floor(row_mask r0, row_mask r1, row_mask r2, row_mask r3, int c) {
+    return (int8_t) ((r3 >> c & 1) ? 3 : (r2 >> c & 1) ? 2 : (r1 >> c & 1) ? 1 : (r0 >> c & 1) ? 0 : -1);
+}
+
+constexpr int8_t mask_right(row_mask cols) {
+    return (int8_t) ((cols & 8) ? 3 : (cols & 4) ? 2 : (cols & 2) ? 1 : 0);
+}
+
+constexpr int8_t mask_left(row_mask cols) {
+    return (int8_t) ((cols & 1) ? 0 : (cols & 2) ? 1 : (cols & 4) ? 2 : 3);
+}
+
+//derives the bounding box and column floors from the rows, usable in constant expressions
+constexpr geometry_mask make_geometry_mask(row_mask r0, row_mask r1, row_mask r2, row_mask r3) {
+    return {
+        {r0, r1, r2, r3},
+        (int8_t) (r0 ? 0 : r1 ? 1 : r2 ? 2 : 3),
+        (int8_t) (r3 ? 3 : r2 ? 2 : r1 ? 1 : 0),
+        mask_left((row_mask) (r0 | r1 | r2 | r3)),
+        mask_right((row_mask) (r0 | r1 | r2 | r3)),
+        {
+            mask_floor(r0, r1, r2, r3, 0),
+            mask_floor(r0, r1, r2, r3, 1),
+            mask_floor(r0, r1, r2, r3, 2),
+            mask_floor(r0, r1, r2, r3, 3)
+        }
+    };
+}
+
+/*
+ Authoring API for figures. The game itself reads the precomputed FigureTable,
+ a figure built from the make_geometry_* methods packs into the same figure_shape.
+ */
 
 class AbstractFigure {
 private:
     std::map<char, geometry> geo;
+    figure_shape shape;
+
+    void init_mask(char i);
 protected:
     virtual geometry make_geometry_top() = 0;
     virtual geometry make_geometry_right() = 0;
@@ -25,6 +80,9 @@ protected:
         geo[1] = make_geometry_bottom();
         geo[2] = make_geometry_left();
         geo[3] = make_geometry_top();
+        for (char i = 0; i <= MAX_ROTATION_INDEX; ++i) {
+            init_mask(i);
+        }
     }
 
 public:
@@ -35,4 +93,13 @@ public:
         assert(geo.count(i) > 0);
         return geo[i];
     }
+
+    const geometry_mask& find_mask(char i) const {
+        assert(i >= 0 && i <= MAX_ROTATION_INDEX);
+        return shape.rotations[(int) i];
+    }
+
+    const figure_shape& find_shape() const {
+        return shape;
+    }
 };
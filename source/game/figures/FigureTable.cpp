@@ -0,0 +1,3 @@
+#include "FigureTable.h"
+
+constexpr figure_shape FigureTable::shapes[FIGURE_COUNT];
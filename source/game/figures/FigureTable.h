@@ -0,0 +1,66 @@
+#pragma once
+
+#include "AbstractFigure.h"
+
+#define FIGURE_COUNT 5
+
+/*
+ Rotations of every figure, built at compile time and shared by all the games.
+
+ Figure ids go from 1 to FIGURE_COUNT, rotation 0 is the spawn orientation and
+ every next one is a clockwise turn, same order as AbstractFigure::init_geometry.
+ */
+class FigureTable {
+public:
+    static constexpr figure_shape shapes[FIGURE_COUNT] = {
+        //Figure1, the stick
+        {{
+            make_geometry_mask(0x0, 0xF, 0x0, 0x0),
+            make_geometry_mask(0x2, 0x2, 0x2, 0x2),
+            make_geometry_mask(0x0, 0xF, 0x0, 0x0),
+            make_geometry_mask(0x2, 0x2, 0x2, 0x2)
+        }},
+        //Figure2, the square
+        {{
+            make_geometry_mask(0x3, 0x3, 0x0, 0x0),
+            make_geometry_mask(0x3, 0x3, 0x0, 0x0),
+            make_geometry_mask(0x3, 0x3, 0x0, 0x0),
+            make_geometry_mask(0x3, 0x3, 0x0, 0x0)
+        }},
+        //Figure3, the T
+        {{
+            make_geometry_mask(0x2, 0x6, 0x2, 0x0),
+            make_geometry_mask(0x0, 0x7, 0x2, 0x0),
+            make_geometry_mask(0x2, 0x3, 0x2, 0x0),
+            make_geometry_mask(0x2, 0x7, 0x0, 0x0)
+        }},
+        //Figure4, the skew
+        {{
+            make_geometry_mask(0x6, 0x3, 0x0, 0x0),
+            make_geometry_mask(0x1, 0x3, 0x2, 0x0),
+            make_geometry_mask(0x3, 0x6, 0x0, 0x0),
+            make_geometry_mask(0x2, 0x3, 0x1, 0x0)
+        }},
+        //Figure5, the L
+        {{
+            make_geometry_mask(0x7, 0x4, 0x0, 0x0),
+            make_geometry_mask(0x2, 0x2, 0x3, 0x0),
+            make_geometry_mask(0x1, 0x7, 0x0, 0x0),
+            make_geometry_mask(0x3, 0x1, 0x1, 0x0)
+        }}
+    };
+
+    static const figure_shape& find_shape(int figure) {
+        assert(figure >= 1 && figure <= FIGURE_COUNT);
+        return shapes[figure - 1];
+    }
+
+    static int find_id(const figure_shape* shape) {
+        return (int) (shape - shapes) + 1;
+    }
+
+    static const geometry_mask& find_mask(int figure, char rotation) {
+        assert(rotation >= 0 && rotation <= MAX_ROTATION_INDEX);
+        return find_shape(figure).rotations[(int) rotation];
+    }
+};
@@ -1,13 +1,33 @@
 #include <iostream>
+#include <cstdio>
 #include <algorithm>
+#include <cmath>
 #include <assert.h>
 #include <vector>
+#include <thread>
 
 #include "TetrisGame.h"
+#include "BatchSimulator.h"
+#include "TetrisBatch.h"
+#include "StdLibRandomProvider.h"
+#include "PlacementFinder.h"
+#include "BeamSearchBot.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include "Replay.h"
+#include "EventBus.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
+#include "LatencyHistogram.h"
+#include "AllocationCounter.h"
 #include "MockRandomNumberProvider.h"
 #include "test.h"
 #include "figures/Figure1.h"
 #include "figures/Figure2.h"
+#include "figures/Figure3.h"
+#include "figures/Figure4.h"
+#include "figures/Figure5.h"
+#include "figures/FigureTable.h"
 
 RandomNumberProvider* rnd_provider = new MockRandomNumberProvider();
 
@@ -390,6 +410,1469 @@ void test_full_row_get_destroyed() {
     ensure_closed_only(game, v);
 }
 
+void ensure_same_shape(const AbstractFigure& authored, int figure) {
+    for (char t = 0; t <= MAX_ROTATION_INDEX; ++t) {
+        const geometry_mask& a = authored.find_mask(t);
+        const geometry_mask& b = FigureTable::find_mask(figure, t);
+        assert(a.top == b.top && a.height == b.height);
+        assert(a.left == b.left && a.right == b.right);
+        for (int k = 0; k < GEOMETRY_SIZE; ++k) {
+            assert(a.rows[k] == b.rows[k]);
+            assert(a.floor[k] == b.floor[k]);
+        }
+    }
+}
+
+void test_figure_table_matches_authored_figures() {
+    ensure_same_shape(Figure1(), 1);
+    ensure_same_shape(Figure2(), 2);
+    ensure_same_shape(Figure3(), 3);
+    ensure_same_shape(Figure4(), 4);
+    ensure_same_shape(Figure5(), 5);
+    const geometry_mask& l = FigureTable::find_mask(5, 1);
+    assert(l.top == 0 && l.height == 2 && l.left == 0 && l.right == 1);
+    assert(l.floor[0] == 2 && l.floor[1] == 2 && l.floor[2] == -1);
+}
+
+void test_batch_does_not_depend_on_threads() {
+    BatchConfig config;
+    config.games = 24;
+    config.max_ticks = 3000;
+    config.seed = 7;
+    config.threads = 1;
+    BatchReport single = BatchSimulator(config).run();
+    config.threads = 4;
+    BatchReport many = BatchSimulator(config).run();
+    assert(single.ticks == many.ticks);
+    assert(single.game_overs == many.game_overs);
+    assert(single.scores == many.scores);
+    assert(single.ticks > config.games);
+}
+
+void ensure_batch_plays_like_games(BatchKernel kernel) {
+    const int boards = 21;
+    const unsigned seed = 11;
+    TetrisBatch batch(boards, seed, kernel);
+    std::vector<TetrisGame*> games;
+    for (int k = 0; k < boards; ++k) {
+        games.push_back(new TetrisGame(PieceQueue(seed, k)));
+    }
+    std::vector<uint8_t> actions(boards);
+    std::vector<bool> over(boards, false);
+    unsigned lcg = 5;
+    for (int step = 0; step < 400 && batch.alive() > 0; ++step) {
+        for (int k = 0; k < boards; ++k) {
+            lcg = lcg * 1103515245 + 12345;
+            actions[k] = (uint8_t) ((lcg >> 16) % 5);
+            if (step % 7 != 0 && actions[k] == ACTION_DROP) {
+                actions[k] = ACTION_NONE;
+            }
+        }
+        batch.step(&actions[0]);
+        for (int k = 0; k < boards; ++k) {
+            TetrisGame& game = *games[k];
+            if (over[k]) {
+                continue;
+            }
+            ProcessResult result = MOVE;
+            switch (actions[k]) {
+                case ACTION_LEFT: game.move_left();
+                    break;
+                case ACTION_RIGHT: game.move_right();
+                    break;
+                case ACTION_ROTATE: game.rotate();
+                    break;
+                case ACTION_DROP: result = game.drop();
+                    break;
+            }
+            if (result != GAME_OVER) {
+                result = game.process();
+            }
+            assert(result == batch.result(k));
+            assert(game.get_score() == batch.get_score(k));
+            over[k] = batch.is_over(k);
+            for (int i = 0; i < GAME_FIELD_ROWS && !over[k]; ++i) {
+                for (int j = 0; j < GAME_FIELD_COLS; ++j) {
+                    assert(game.is_free(i, j) == batch.is_free(k, i, j));
+                }
+            }
+        }
+    }
+    for (auto g : games) {
+        delete g;
+    }
+}
+
+void test_batch_plays_like_games() {
+    ensure_batch_plays_like_games(KERNEL_SCALAR);
+    ensure_batch_plays_like_games(TetrisBatch::best_kernel());
+}
+
+//inputs as PlacementFinder writes them
+template <class Game>
+ProcessResult play_input(Game& game, int input) {
+    return play_input(game, (GameInput) input);
+}
+
+template <class Game, class Finder>
+void ensure_placements_reachable(Game& game, Finder& finder) {
+    for (int p = 0; p < finder.size(); ++p) {
+        const placement& target = finder.get(p);
+        Game copy = game;
+        uint8_t inputs[Finder::states];
+        int length = finder.inputs(p, inputs, Finder::states);
+        assert(length > 0 && inputs[length - 1] == INPUT_DROP);
+        for (int k = 0; k < length - 1; ++k) {
+            assert(MOVE == play_input(copy, inputs[k]));
+        }
+        assert(copy.get_rotation() == target.rotation && copy.get_col() == target.col);
+        const geometry_mask& geo = copy.get_figure()->rotations[(int) target.rotation];
+        copy.drop();
+        //the cells of a placement that clears rows move with the rows
+        for (int r = 0; r < GEOMETRY_SIZE && !copy.get_cleared(); ++r) {
+            for (int c = 0; c < GEOMETRY_SIZE; ++c) {
+                if (geo.rows[r] >> c & 1) {
+                    assert(copy.get_rows()[target.row + r] >> (target.col + c) & 1);
+                }
+            }
+        }
+        for (int q = 0; q < p; ++q) {
+            const placement& other = finder.get(q);
+            assert(other.row != target.row || other.col != target.col || other.rotation != target.rotation);
+        }
+    }
+}
+
+void test_finds_placements_of_square() {
+    MockRandomNumberProvider rnd_p(2);
+    TetrisGame game(&rnd_p);
+    PlacementFinder finder;
+    assert(GAME_FIELD_COLS - 3 == finder.find(game));
+    ensure_placements_reachable(game, finder);
+}
+
+void test_finds_placements_of_stick() {
+    TetrisGame game(rnd_provider);
+    PlacementFinder finder;
+    assert(GAME_FIELD_COLS - 5 + GAME_FIELD_COLS - 2 == finder.find(game));
+    ensure_placements_reachable(game, finder);
+}
+
+void test_finds_placements_on_rough_board() {
+    StdLibRandomProvider rnd_p(3);
+    TetrisGame game(&rnd_p);
+    PlacementFinder finder;
+    for (int piece = 0; piece < 12; ++piece) {
+        int found = finder.find(game);
+        assert(found > 0);
+        ensure_placements_reachable(game, finder);
+        uint8_t inputs[PLACEMENT_STATES];
+        int length = finder.inputs(piece * 5 % found, inputs, PLACEMENT_STATES);
+        for (int k = 0; k < length; ++k) {
+            play_input(game, inputs[k]);
+        }
+    }
+}
+
+void ensure_same_game(TetrisGame& a, TetrisGame& b) {
+    assert(a.get_figure() == b.get_figure());
+    assert(a.get_rotation() == b.get_rotation());
+    assert(a.get_row() == b.get_row() && a.get_col() == b.get_col());
+    assert(a.get_score() == b.get_score());
+    assert(a.get_hash() == b.get_hash());
+    for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+        for (int j = 0; j < GAME_FIELD_COLS; ++j) {
+            assert(a.is_free(i, j) == b.is_free(i, j));
+            assert(a.get_color(i, j) == b.get_color(i, j));
+        }
+    }
+}
+
+template <class Game>
+void ensure_features_match_rows(const Game& game) {
+    const typename Game::features_type& f = game.get_features();
+    int rows = game.get_field_rows();
+    int cols = game.get_field_cols();
+    int holes = 0;
+    int aggregate = 0;
+    for (int j = 0; j < cols; ++j) {
+        int height = 0;
+        for (int i = 0; i < rows; ++i) {
+            bool taken = j > 0 && j < cols - 1 && game.get_rows()[i] >> j & 1;
+            assert(taken == (f.columns[j] >> i & 1));
+            if (taken && !height) {
+                height = rows - i;
+            } else if (!taken && height) {
+                holes++;
+            }
+        }
+        assert(f.heights[j] == height);
+        aggregate += height;
+    }
+    for (int i = 0; i < rows; ++i) {
+        int fill = 0;
+        for (int j = 1; j < cols - 1; ++j) {
+            fill += game.get_rows()[i] >> j & 1;
+        }
+        assert(f.fills[i] == fill);
+    }
+    assert(f.holes == holes);
+    assert(f.aggregate_height == aggregate);
+}
+
+void explore_and_undo(TetrisGame& game, int depth) {
+    TetrisGame before = game;
+    PlacementFinder finder;
+    int found = finder.find(game);
+    for (int p = 0; p < found; p += 3) {
+        int journaled = game.journal_size();
+        ProcessResult result = game.apply(finder.get(p));
+        assert(game.journal_size() == journaled + 1);
+        if (depth > 0 && result != GAME_OVER) {
+            explore_and_undo(game, depth - 1);
+        }
+        assert(game.undo());
+        ensure_same_game(game, before);
+        assert(game.get_cleared() == before.get_cleared());
+        ensure_features_match_rows(game);
+    }
+}
+
+//`game`, `reference` and `fresh` are new games dealt the same figures
+void ensure_undo_restores_game(TetrisGame& game, TetrisGame& reference, TetrisGame& fresh) {
+    PlacementFinder finder;
+    for (int piece = 0; piece < 40; ++piece) {
+        explore_and_undo(game, 1);
+        ensure_same_game(game, reference);
+        assert(game.get_cleared() == reference.get_cleared());
+        int found = finder.find(game);
+        if (!found) {
+            break;
+        }
+        //lowest placement first, so that rows get cleared on the way
+        int best = 0;
+        for (int p = 1; p < found; ++p) {
+            if (finder.get(p).row > finder.get(best).row) {
+                best = p;
+            }
+        }
+        uint8_t inputs[PLACEMENT_STATES];
+        int length = finder.inputs(best, inputs, PLACEMENT_STATES);
+        for (int k = 0; k < length; ++k) {
+            play_input(reference, inputs[k]);
+        }
+        ProcessResult result = game.apply(finder.get(best));
+        ensure_same_game(game, reference);
+        assert(game.get_cleared() == reference.get_cleared());
+        if (result == GAME_OVER) {
+            break;
+        }
+    }
+    assert(game.get_score() > 0);
+    while (game.undo());
+    assert(game.journal_size() == 0);
+    ensure_same_game(game, fresh);
+    assert(game.get_cleared() == fresh.get_cleared());
+    fresh.drop();
+    game.drop();
+    ensure_same_game(game, fresh);
+}
+
+void test_undo_restores_game() {
+    StdLibRandomProvider rnd_p(21);
+    StdLibRandomProvider reference_rnd_p(21);
+    StdLibRandomProvider fresh_rnd_p(21);
+    TetrisGame game(&rnd_p);
+    TetrisGame reference(&reference_rnd_p);
+    TetrisGame fresh(&fresh_rnd_p);
+    ensure_undo_restores_game(game, reference, fresh);
+    //same walk with the figures dealt from a piece queue, rewound by undo
+    PieceQueue pieces(21, 0, 2, 3);
+    TetrisGame queued(pieces);
+    TetrisGame queued_reference(pieces);
+    TetrisGame queued_fresh(pieces);
+    ensure_undo_restores_game(queued, queued_reference, queued_fresh);
+}
+
+void test_undo_takes_back_figures_not_dealt() {
+    PieceQueue pieces(5, 0, 2, 3);
+    TetrisGame game(pieces);
+    TetrisGame fresh(pieces);
+    PlacementFinder finder;
+    uint64_t empty = game.get_board_hash();
+    for (int f = 1; f <= FIGURE_COUNT; ++f) {
+        const figure_shape* figure = &FigureTable::find_shape(f);
+        int found = finder.find(game.get_rows(), figure, 0, 0, SPAWN_COL);
+        assert(found > 0);
+        for (int p = 0; p < found; ++p) {
+            game.apply(finder.get(p), figure);
+            assert(game.get_board_hash() != empty);
+            assert(game.get_features().aggregate_height > 0);
+            game.undo();
+            ensure_same_game(game, fresh);
+            assert(game.get_board_hash() == empty);
+        }
+    }
+}
+
+void test_spawns_every_figure() {
+    StdLibRandomProvider rnd_p(4);
+    TetrisGame game(&rnd_p);
+    std::vector<int> seen(FIGURE_COUNT + 1, 0);
+    for (int piece = 0; piece < 200; ++piece) {
+        seen[FigureTable::find_id(game.get_figure())]++;
+        if (game.drop() == GAME_OVER) {
+            game = TetrisGame(&rnd_p);
+        }
+    }
+    for (int f = 1; f <= FIGURE_COUNT; ++f) {
+        assert(seen[f] > 0);
+    }
+}
+
+void test_piece_queue_deals_bags() {
+    for (int bag = 1; bag <= 3; ++bag) {
+        PieceQueue pieces(9, 0, bag);
+        for (int block = 0; block < 50; ++block) {
+            std::vector<int> count(FIGURE_COUNT + 1, 0);
+            for (int k = 0; k < FIGURE_COUNT * bag; ++k) {
+                count[pieces.next().figure]++;
+            }
+            for (int f = 1; f <= FIGURE_COUNT; ++f) {
+                assert(count[f] == bag);
+            }
+        }
+    }
+    PieceQueue free(9, 0, 0);
+    std::vector<int> count(FIGURE_COUNT + 1, 0);
+    for (int k = 0; k < 500; ++k) {
+        queued_piece p = free.next();
+        assert(p.figure >= 1 && p.figure <= FIGURE_COUNT);
+        assert(p.tint >= 0.0f && p.tint < 9.0f);
+        count[p.figure]++;
+    }
+    for (int f = 1; f <= FIGURE_COUNT; ++f) {
+        assert(count[f] > 500 / FIGURE_COUNT / 2);
+    }
+}
+
+void test_piece_queue_previews_and_rewinds() {
+    for (int bag = 0; bag <= 2; ++bag) {
+        PieceQueue pieces(13, 0, bag, MAX_PREVIEW);
+        std::vector<int> dealt;
+        for (int k = 0; k < 400; ++k) {
+            int next = pieces.peek(0).figure;
+            assert(pieces.peek(MAX_PREVIEW - 1).figure >= 1);
+            dealt.push_back(pieces.next().figure);
+            assert(dealt.back() == next);
+        }
+        assert(pieces.position() == 400);
+        //back within the ring, back past it, and forward past the pieces made so far
+        int positions[] = {390, 380, 17, 0, 399, 250, 398};
+        for (int position : positions) {
+            pieces.rewind(position);
+            for (int k = position; k < position + 3 && k < 400; ++k) {
+                assert(pieces.next().figure == dealt[k]);
+            }
+        }
+        PieceQueue ahead(13, 0, bag, MAX_PREVIEW);
+        ahead.rewind(1000);
+        pieces.rewind(1000);
+        for (int k = 0; k < 40; ++k) {
+            assert(ahead.next().figure == pieces.next().figure);
+        }
+    }
+}
+
+void test_philox_matches_known_answers() {
+    philox_block zero = Philox::generate(0, 0, 0);
+    assert(zero.words[0] == 0x6627e8d5 && zero.words[1] == 0xe169c58d);
+    assert(zero.words[2] == 0xbc57ac4c && zero.words[3] == 0x9b00dbd8);
+    philox_block ones = Philox::generate(~0ull, ~0ull, ~0ull);
+    assert(ones.words[0] == 0x408f276d && ones.words[1] == 0x41c83b0e);
+    assert(ones.words[2] == 0xa20bc7c6 && ones.words[3] == 0x6d5451fd);
+    philox_block pi = Philox::generate(0x85a308d3243f6a88ull, 0x0370734413198a2eull, 0x299f31d0a4093822ull);
+    assert(pi.words[0] == 0xd16cfe09 && pi.words[1] == 0x94fdcceb);
+    assert(pi.words[2] == 0x5001e420 && pi.words[3] == 0x24126ea1);
+}
+
+void test_pieces_are_random_access() {
+    for (int bag = 0; bag <= 2; ++bag) {
+        //games dealt out of order, in two interleaved shards, give the same pieces
+        for (int game = 5; game >= 0; --game) {
+            PieceQueue pieces(77, game, bag);
+            for (uint64_t k = 0; k < 300; ++k) {
+                queued_piece p = pieces.next();
+                queued_piece q = PieceQueue::piece_at(77, game, bag, k);
+                assert(p.figure == q.figure && p.tint == q.tint);
+            }
+        }
+        queued_piece far = PieceQueue::piece_at(77, 3, bag, 1ull << 40);
+        PieceQueue pieces(77, 3, bag);
+        pieces.rewind(1ull << 40);
+        assert(pieces.next().figure == far.figure);
+    }
+    //neighbouring games and seeds do not share their pieces
+    int same_game = 0;
+    int same_seed = 0;
+    for (uint64_t k = 0; k < 200; ++k) {
+        same_game += PieceQueue::piece_at(77, 0, 0, k).figure == PieceQueue::piece_at(77, 1, 0, k).figure;
+        same_seed += PieceQueue::piece_at(77, 0, 0, k).figure == PieceQueue::piece_at(78, 0, 0, k).figure;
+    }
+    assert(same_game < 200 / 2 && same_seed < 200 / 2);
+}
+
+void test_game_previews_figures_of_queue() {
+    TetrisGame game(PieceQueue(3, 0, 1, 4));
+    const figure_shape* preview[MAX_PREVIEW];
+    for (int piece = 0; piece < 20; ++piece) {
+        assert(game.get_preview(preview, MAX_PREVIEW) == 4);
+        const figure_shape* next = preview[0];
+        assert(game.get_preview(preview, 2) == 2);
+        if (game.drop() == GAME_OVER) {
+            break;
+        }
+        assert(game.get_figure() == next);
+    }
+    StdLibRandomProvider rnd_p(1);
+    TetrisGame unqueued(&rnd_p);
+    assert(unqueued.get_preview(preview, MAX_PREVIEW) == 0);
+}
+
+void drop_square(TetrisGame& game, int shift) {
+    for (int k = 0; k < shift; ++k) {
+        game.move_right();
+    }
+    for (int k = 0; k > shift; --k) {
+        game.move_left();
+    }
+    game.drop();
+}
+
+uint64_t recompute_hash(const TetrisGame& game) {
+    uint64_t key = 0;
+    for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
+        key ^= Zobrist::row_key(i, game.get_rows()[i] & CELLS_ROW_MASK);
+    }
+    if (game.get_figure()) {
+        int figure = FigureTable::find_id(game.get_figure());
+        key ^= Zobrist::piece_key(figure, game.get_rotation(), game.get_row(), game.get_col());
+    }
+    return key;
+}
+
+void test_tracks_board_features() {
+    MockRandomNumberProvider p(2);
+    TetrisGame game(&p);
+    ensure_features_match_rows(game);
+    assert(game.get_features().max_height() == 0);
+    //two squares side by side and one on top of the left one
+    drop_square(game, -4);
+    drop_square(game, -2);
+    drop_square(game, -4);
+    const board_features& f = game.get_features();
+    assert(f.heights[1] == 4 && f.heights[2] == 4 && f.heights[3] == 2 && f.heights[4] == 2);
+    assert(f.max_height() == 4 && f.aggregate_height == 12);
+    assert(f.bumpiness() == 2 + 2);
+    assert(f.holes == 0);
+    assert(f.fills[GAME_FIELD_ROWS - 1] == 4 && f.fills[GAME_FIELD_ROWS - 3] == 2);
+    ensure_features_match_rows(game);
+    //filling the two bottom rows clears them and brings the heights down
+    drop_square(game, 0);
+    drop_square(game, 2);
+    drop_square(game, 4);
+    assert(game.get_score() == 2);
+    assert(game.get_cleared() == 3u << (GAME_FIELD_ROWS - 2));
+    assert(f.heights[1] == 2 && f.heights[3] == 0 && f.aggregate_height == 4);
+    ensure_features_match_rows(game);
+    drop_square(game, 0);
+    assert(game.get_cleared() == 0);
+}
+
+void test_clears_rows_apart() {
+    PieceQueue pieces(3);
+    TetrisGame game(pieces);
+    const int n = GAME_FIELD_ROWS;
+    const int c = 5;
+    game_state state;
+    game.save(state);
+    uint64_t empty = state.rows[0];
+    uint64_t cells = 0;
+    for (int j = 1; j < GAME_FIELD_COLS - 1; ++j) {
+        cells |= 1ull << j;
+    }
+    //rows n - 1 and n - 3 full but column c, a partial row between them and two above
+    state.rows[n - 1] = (empty | cells) & ~(1ull << c);
+    state.rows[n - 2] = empty | 1ull << 1 | 1ull << 2;
+    state.rows[n - 3] = (empty | cells) & ~(1ull << c);
+    state.rows[n - 4] = empty | 1ull << 1;
+    state.rows[n - 5] = empty | 1ull << 2;
+    state.figure = 1;
+    state.rotation = 0;
+    state.row = 0;
+    state.col = SPAWN_COL;
+    game.restore(state);
+    vec4 color = game.get_color(1, SPAWN_COL);
+
+    //the stick stood up in column c fills both full rows
+    PlacementFinder finder;
+    int found = finder.find(game);
+    int stick = -1;
+    for (int p = 0; p < found; ++p) {
+        const placement& at = finder.get(p);
+        if (at.rotation % 2 && at.col + 1 == c && at.row == n - 4) {
+            stick = p;
+        }
+    }
+    assert(stick >= 0);
+    assert(game.apply(finder.get(stick)) == DESTROY);
+    assert(game.get_cleared() == (1ull << (n - 1) | 1ull << (n - 3)));
+    assert(game.get_score() == 2);
+
+    //the partial row and the rows above it come down by one and two
+    const TetrisGame::row_type* rows = game.get_rows();
+    assert(rows[n - 1] == (empty | 1ull << 1 | 1ull << 2 | 1ull << c));
+    assert(rows[n - 2] == (empty | 1ull << 1 | 1ull << c));
+    assert(rows[n - 3] == (empty | 1ull << 2));
+    for (int i = 0; i < n - 3; ++i) {
+        assert(rows[i] == empty);
+    }
+    vec4 blank(0.0f, 0.0f, 0.0f, 0.0f);
+    assert(color != blank);
+    assert(game.get_color(n - 1, c) == color && game.get_color(n - 2, c) == color);
+    assert(game.get_color(n - 3, c) == blank && game.get_color(n - 1, c + 1) == blank);
+
+    const board_features& f = game.get_features();
+    assert(f.heights[1] == 2 && f.heights[2] == 3 && f.heights[c] == 2 && f.heights[c + 1] == 0);
+    assert(f.holes == 1 && f.aggregate_height == 7);
+    assert(f.fills[n - 1] == 3 && f.fills[n - 2] == 2 && f.fills[n - 3] == 1);
+    ensure_features_match_rows(game);
+}
+
+void test_hash_does_not_depend_on_move_order() {
+    MockRandomNumberProvider p(2);
+    TetrisGame a(&p);
+    TetrisGame b(&p);
+    drop_square(a, -4);
+    drop_square(a, 4);
+    drop_square(b, 4);
+    drop_square(b, -4);
+    assert(a.get_hash() == b.get_hash());
+    assert(a.get_hash() == recompute_hash(a));
+    TetrisGame c(&p);
+    drop_square(c, 4);
+    drop_square(c, 2);
+    assert(a.get_hash() != c.get_hash());
+    a.move_left();
+    assert(a.get_hash() != b.get_hash());
+    a.move_right();
+    assert(a.get_hash() == b.get_hash());
+}
+
+void test_hash_matches_recompute() {
+    StdLibRandomProvider rnd_p(5);
+    StdLibRandomProvider inputs_p(6);
+    TetrisGame game(&rnd_p);
+    for (int tick = 0; tick < 3000; ++tick) {
+        if (play_input(game, inputs_p.next_int(5) - 1) == GAME_OVER || game.process() == GAME_OVER) {
+            break;
+        }
+        assert(game.get_hash() == recompute_hash(game));
+        ensure_features_match_rows(game);
+    }
+}
+
+void test_transposition_table_stores_and_probes() {
+    TranspositionTable table(1);
+    assert(table.capacity() == 1024 * 1024 / 16);
+    tt_entry entry = {-42, 3, 7};
+    tt_entry found;
+    assert(!table.probe(12345, found));
+    table.store(12345, entry);
+    assert(table.probe(12345, found));
+    assert(found.value == -42 && found.depth == 3 && found.move == 7);
+    //zero entries are valid entries
+    tt_entry zero = {0, 0, 0};
+    table.store(777, zero);
+    assert(table.probe(777, found) && found.value == 0);
+    tt_stats stats = table.stats();
+    assert(stats.hits == 2 && stats.misses == 1 && stats.stores == 2 && stats.replacements == 0);
+    table.clear();
+    assert(!table.probe(12345, found));
+}
+
+void test_transposition_table_keeps_deeper_entries() {
+    TranspositionTable table(1);
+    uint64_t buckets = table.capacity() / 4;
+    //five keys of the same bucket, the shallowest of the first four gets evicted
+    for (int k = 0; k < 4; ++k) {
+        tt_entry entry = {k, (int8_t) (k + 1), 0};
+        table.store(1 + k * buckets, entry);
+    }
+    tt_entry shallow = {100, 0, 0};
+    table.store(1 + 4 * buckets, shallow);
+    tt_entry found;
+    assert(!table.probe(1 + 4 * buckets, found));
+    tt_entry deep = {100, 5, 0};
+    table.store(1 + 4 * buckets, deep);
+    assert(table.probe(1 + 4 * buckets, found) && found.value == 100);
+    assert(!table.probe(1, found));
+    assert(table.stats().replacements == 1);
+    //after a new search every old entry can go
+    table.new_search();
+    table.store(1 + 5 * buckets, shallow);
+    assert(table.probe(1 + 5 * buckets, found));
+
+    TranspositionTable always(1, REPLACE_ALWAYS);
+    for (int k = 0; k < 4; ++k) {
+        tt_entry entry = {k, 9, 0};
+        always.store(1 + k * buckets, entry);
+    }
+    always.store(1 + 4 * buckets, shallow);
+    assert(always.probe(1 + 4 * buckets, found));
+}
+
+void test_transposition_table_is_never_torn() {
+    TranspositionTable table(1);
+    //a tiny key space, so that threads keep overwriting each other's slots
+    auto value_of = [](uint64_t key) {
+        return (int32_t) (Zobrist::mix(key) & 0x7FFFFFFF);
+    };
+    auto hammer = [&](int seed) {
+        uint64_t state = seed;
+        for (int n = 0; n < 200000; ++n) {
+            state = Zobrist::mix(state + n);
+            uint64_t key = (state % 64) * (table.capacity() / 4) + 1;
+            tt_entry found;
+            if (state & 1) {
+                tt_entry entry = {value_of(key), (int8_t) (state >> 8 & 15), (uint16_t) key};
+                table.store(key, entry);
+            } else if (table.probe(key, found)) {
+                assert(found.value == value_of(key));
+                assert(found.move == (uint16_t) key);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread(hammer, t + 1));
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+    tt_stats stats = table.stats();
+    assert(stats.hits + stats.misses > 0 && stats.stores > 0);
+}
+
+int play_bot(BeamSearchBot& bot, unsigned seed, int pieces, std::vector<placement>* moves) {
+    StdLibRandomProvider rnd_p(seed);
+    TetrisGame game(&rnd_p);
+    BotMove move;
+    for (int piece = 0; piece < pieces && bot.think(game, move); ++piece) {
+        if (moves) {
+            moves->push_back(move.target);
+        }
+        assert(move.length > 0 && move.inputs[move.length - 1] == INPUT_DROP);
+        ProcessResult result = MOVE;
+        for (int k = 0; k < move.length; ++k) {
+            result = play_input(game, move.inputs[k]);
+        }
+        if (result == GAME_OVER) {
+            break;
+        }
+    }
+    return game.get_score();
+}
+
+void test_bot_clears_rows() {
+    BotConfig config;
+    config.width = 4;
+    config.threads = 1;
+    BeamSearchBot bot(config);
+    assert(play_bot(bot, 3, 300, 0) >= 50);
+}
+
+void test_bot_does_not_depend_on_threads() {
+    BotConfig config;
+    config.width = 6;
+    config.depth = 3;
+    config.threads = 1;
+    BeamSearchBot single(config);
+    config.threads = 3;
+    BeamSearchBot multi(config);
+    std::vector<placement> a;
+    std::vector<placement> b;
+    int score = play_bot(single, 8, 60, &a);
+    assert(score == play_bot(multi, 8, 60, &b));
+    assert(a.size() == b.size());
+    for (size_t k = 0; k < a.size(); ++k) {
+        assert(a[k].rotation == b[k].rotation && a[k].row == b[k].row && a[k].col == b[k].col);
+    }
+}
+
+void test_bot_searches_known_figures_and_one_more() {
+    MockRandomNumberProvider rnd_p(2);
+    TetrisGame game(&rnd_p);
+    BotConfig config;
+    config.depth = 4;
+    config.threads = 1;
+    BeamSearchBot bot(config);
+    BotMove move;
+    const figure_shape* preview = &FigureTable::find_shape(1);
+    assert(bot.think(game, move, &preview, 1));
+    assert(move.levels == 3);
+    assert(bot.think(game, move));
+    assert(move.levels == 2);
+    config.depth = 1;
+    BeamSearchBot greedy(config);
+    assert(greedy.think(game, move));
+    assert(move.levels == 1);
+    //the square goes flat on the floor
+    assert(move.target.row == GAME_FIELD_ROWS - 2);
+}
+
+//plays `pieces` figures of `bot` on `game`, checking the placements found on the way
+template <int Rows, int Cols>
+int ensure_bot_plays_well(BasicTetrisGame<Rows, Cols>& game, BasicBeamSearchBot<Rows, Cols>& bot, int pieces) {
+    BasicPlacementFinder<Rows, Cols> finder(game.get_field_rows(), game.get_field_cols());
+    basic_bot_move<Rows, Cols> move;
+    for (int piece = 0; piece < pieces && bot.think(game, move); ++piece) {
+        if (piece % 20 == 0) {
+            assert(finder.find(game) > 0);
+            ensure_placements_reachable(game, finder);
+        }
+        assert(move.length > 0 && move.inputs[move.length - 1] == INPUT_DROP);
+        ProcessResult result = MOVE;
+        for (int k = 0; k < move.length; ++k) {
+            result = play_input(game, move.inputs[k]);
+        }
+        if (result == GAME_OVER) {
+            break;
+        }
+    }
+    return game.get_score();
+}
+
+void test_bot_plays_wells_of_other_sizes() {
+    BotConfig config;
+    config.width = 4;
+    config.threads = 1;
+    StdLibRandomProvider narrow_p(6);
+    BasicTetrisGame<GAME_FIELD_ROWS, 18> narrow(&narrow_p);
+    BasicBeamSearchBot<GAME_FIELD_ROWS, 18> narrow_bot(config);
+    assert(ensure_bot_plays_well(narrow, narrow_bot, 150) > 0);
+    StdLibRandomProvider wide_p(6);
+    BasicTetrisGame<GAME_FIELD_ROWS, 42> wide(&wide_p);
+    BasicBeamSearchBot<GAME_FIELD_ROWS, 42> wide_bot(config);
+    assert(ensure_bot_plays_well(wide, wide_bot, 150) > 0);
+    StdLibRandomProvider tall_p(6);
+    BasicTetrisGame<42, GAME_FIELD_COLS> tall(&tall_p);
+    BasicBeamSearchBot<42, GAME_FIELD_COLS> tall_bot(config);
+    assert(ensure_bot_plays_well(tall, tall_bot, 150) > 0);
+    //the dynamic well plays like the one of the same size
+    StdLibRandomProvider wide_again_p(6);
+    StdLibRandomProvider dynamic_p(6);
+    BasicTetrisGame<GAME_FIELD_ROWS, 42> wide_again(&wide_again_p);
+    DynamicTetrisGame dynamic(&dynamic_p, GAME_FIELD_ROWS, 42);
+    BasicBeamSearchBot<DYNAMIC_SIZE, DYNAMIC_SIZE> dynamic_bot(config, GAME_FIELD_ROWS, 42);
+    assert(ensure_bot_plays_well(dynamic, dynamic_bot, 60) == ensure_bot_plays_well(wide_again, wide_bot, 60));
+    assert(dynamic.get_hash() == wide_again.get_hash());
+}
+
+template <int Rows, int Cols>
+void ensure_plays_like_dynamic_well(unsigned seed) {
+    StdLibRandomProvider rnd_p(seed);
+    StdLibRandomProvider dynamic_rnd_p(seed);
+    StdLibRandomProvider inputs_p(seed + 1);
+    BasicTetrisGame<Rows, Cols> game(&rnd_p);
+    DynamicTetrisGame dynamic(&dynamic_rnd_p, Rows, Cols);
+    assert(dynamic.get_field_rows() == Rows && dynamic.get_field_cols() == Cols);
+    for (int tick = 0; tick < 3000; ++tick) {
+        int input = inputs_p.next_int(5) - 1;
+        ProcessResult a = MOVE;
+        ProcessResult b = MOVE;
+        switch (input) {
+            case INPUT_ROTATE: assert(game.rotate() == dynamic.rotate());
+                break;
+            case INPUT_LEFT: assert(game.move_left() == dynamic.move_left());
+                break;
+            case INPUT_RIGHT: assert(game.move_right() == dynamic.move_right());
+                break;
+            case INPUT_DROP: a = game.drop();
+                b = dynamic.drop();
+                break;
+        }
+        assert(a == b);
+        if (a != GAME_OVER) {
+            a = game.process();
+            assert(a == dynamic.process());
+        }
+        assert(game.get_hash() == dynamic.get_hash());
+        assert(game.get_score() == dynamic.get_score());
+        if (a == GAME_OVER) {
+            break;
+        }
+    }
+    ensure_features_match_rows(game);
+    ensure_features_match_rows(dynamic);
+}
+
+void test_wells_of_other_sizes_play_like_dynamic_ones() {
+    ensure_plays_like_dynamic_well<GAME_FIELD_ROWS, GAME_FIELD_COLS>(31);
+    ensure_plays_like_dynamic_well<GAME_FIELD_ROWS, 18>(32);
+    ensure_plays_like_dynamic_well<GAME_FIELD_ROWS, 42>(33);
+    ensure_plays_like_dynamic_well<42, GAME_FIELD_COLS>(34);
+}
+
+void test_clears_rows_of_wide_well() {
+    MockRandomNumberProvider p(2);
+    BasicTetrisGame<GAME_FIELD_ROWS, 42> game(&p);
+    //twenty squares from the left border to the right one
+    for (int col = 1; col < 41; col += 2) {
+        while (game.get_col() > col && game.move_left());
+        while (game.get_col() < col && game.move_right());
+        assert(game.get_col() == col);
+        assert(game.get_score() == 0);
+        game.drop();
+    }
+    assert(game.get_score() == 2);
+    assert(game.get_cleared() == 3ull << (GAME_FIELD_ROWS - 2));
+    assert(game.get_features().aggregate_height == 0);
+    assert(game.is_free(GAME_FIELD_ROWS - 1, 40));
+}
+
+//plays random inputs, 1 in 3 of them a tick, recording them as they go
+template <class Game>
+void play_recorded(Game& game, ReplayWriter& writer, std::vector<GameInput>& played, int count) {
+    static const GameInput choices[] = {
+        INPUT_DOWN, INPUT_DOWN, INPUT_DOWN, INPUT_ROTATE, INPUT_LEFT, INPUT_LEFT, INPUT_RIGHT, INPUT_RIGHT, INPUT_DROP
+    };
+    StdLibRandomProvider inputs(11);
+    for (int k = 0; k < count; ++k) {
+        GameInput input = choices[inputs.next_int(9)];
+        played.push_back(input);
+        if (GAME_OVER == writer.play(game, input)) {
+            break;
+        }
+    }
+    writer.finish(game.get_hash(), game.get_score());
+}
+
+void test_replay_plays_back_inputs() {
+    replay_header header(7, 3);
+    TetrisGame game(header.queue());
+    ReplayWriter writer(header);
+    std::vector<GameInput> played;
+    play_recorded(game, writer, played, 3000);
+
+    ReplayReader reader(&writer.data()[0], writer.data().size());
+    assert(reader.is_valid());
+    assert(reader.header().seed == 7 && reader.header().game == 3);
+    assert(reader.inputs() + reader.ticks() == (long long) played.size());
+    GameInput input;
+    for (size_t k = 0; k < played.size(); ++k) {
+        assert(reader.next(input));
+        assert(input == played[k]);
+    }
+    assert(!reader.next(input));
+    assert(reader.is_valid());
+
+    replay_result result = ReplayPlayer::verify(&writer.data()[0], writer.data().size());
+    assert(result.valid && result.verified);
+    assert(result.hash == game.get_hash() && result.score == game.get_score());
+
+    //and on a well of another size
+    header.cols = 18;
+    DynamicTetrisGame wide(header.queue(), header.rows, header.cols);
+    ReplayWriter wide_writer(header);
+    played.clear();
+    play_recorded(wide, wide_writer, played, 3000);
+    result = ReplayPlayer::verify(&wide_writer.data()[0], wide_writer.data().size());
+    assert(result.verified && result.hash == wide.get_hash());
+}
+
+//the bot places up to `pieces` figures while gravity ticks once every `tick_every` inputs, if at all
+int play_bot_recorded(TetrisGame& game, ReplayWriter& writer, std::vector<GameInput>& played, int pieces, int tick_every) {
+    BotConfig config;
+    config.width = 4;
+    config.threads = 1;
+    BeamSearchBot bot(config);
+    BotMove move;
+    int placed = 0;
+    int inputs = 0;
+    bool over = false;
+    for (; placed < pieces && !over && bot.think(game, move); ++placed) {
+        for (int k = 0; k < move.length && !over; ++k) {
+            GameInput input = (GameInput) move.inputs[k];
+            if (tick_every && ++inputs % tick_every == 0 && input != INPUT_DOWN) {
+                played.push_back(INPUT_DOWN);
+                writer.play(game, INPUT_DOWN);
+            }
+            played.push_back(input);
+            over = GAME_OVER == writer.play(game, input);
+        }
+    }
+    writer.finish(game.get_hash(), game.get_score());
+    return placed;
+}
+
+void test_replay_packs_bot_placements() {
+    replay_header header(5);
+    TetrisGame game(header.queue());
+    ReplayWriter writer(header);
+    std::vector<GameInput> played;
+    int pieces = play_bot_recorded(game, writer, played, 200, 0);
+    assert(game.get_score() > 0);
+    //a few bytes per piece, the header aside
+    assert(writer.data().size() < (size_t) (64 + 3 * pieces));
+    assert(ReplayPlayer::verify(&writer.data()[0], writer.data().size()).verified);
+
+    const char* path = "test_replay.trp";
+    assert(writer.save(path));
+    replay_result result = ReplayPlayer::verify(path);
+    std::remove(path);
+    assert(result.verified && result.hash == game.get_hash());
+}
+
+void test_replay_detects_tampering() {
+    replay_header header(9);
+    TetrisGame game(header.queue());
+    //without keyframes the stream is followed by the 20 bytes of the trailer only
+    ReplayWriter writer(header, 0);
+    std::vector<GameInput> played;
+    play_recorded(game, writer, played, 2000);
+    const std::vector<uint8_t>& data = writer.data();
+    assert(writer.keyframes() == 0);
+
+    //a different input somewhere in the stream plays another game
+    std::vector<uint8_t> bytes(data);
+    bytes[bytes.size() - 25] ^= 0x10;
+    replay_result result = ReplayPlayer::verify(&bytes[0], bytes.size());
+    assert(!result.verified);
+
+    bytes.assign(data.begin(), data.end() - 1);
+    assert(!ReplayPlayer::verify(&bytes[0], bytes.size()).valid);
+    bytes.assign(data.begin(), data.end());
+    bytes[0] = 'X';
+    assert(!ReplayPlayer::verify(&bytes[0], bytes.size()).valid);
+
+    //replays of other engine versions may play out differently
+    header.engine_version = ENGINE_VERSION + 1;
+    ReplayWriter future(header);
+    future.finish(0, 0);
+    assert(!ReplayPlayer::verify(&future.data()[0], future.data().size()).valid);
+    assert(!ReplayPlayer::verify("no_such_replay.trp").valid);
+}
+
+void test_replay_seeks_through_keyframes() {
+    replay_header header(4, 1);
+    TetrisGame game(header.queue());
+    ReplayWriter writer(header, 50);
+    std::vector<GameInput> played;
+    play_bot_recorded(game, writer, played, 300, 3);
+    assert(writer.keyframes() > 20);
+
+    ReplayReader reader(&writer.data()[0], writer.data().size());
+    assert(reader.is_valid() && reader.keyframes() == writer.keyframes());
+    long long targets[] = {0, 1, 49, 50, 51, 777, reader.steps() / 2, reader.steps() - 1, reader.steps(), 1234, 3};
+    for (long long target : targets) {
+        TetrisGame reference(header.queue());
+        for (long long k = 0; k < target; ++k) {
+            play_input(reference, played[k]);
+        }
+        TetrisGame seeked(header.queue());
+        assert(reader.seek(target, seeked));
+        assert(reader.position() == target);
+        assert(seeked.get_hash() == reference.get_hash());
+        assert(seeked.get_score() == reference.get_score());
+        ensure_features_match_rows(seeked);
+        const figure_shape* a[MAX_PREVIEW];
+        const figure_shape* b[MAX_PREVIEW];
+        int count = seeked.get_preview(a, MAX_PREVIEW);
+        assert(count == reference.get_preview(b, MAX_PREVIEW));
+        assert(std::equal(a, a + count, b));
+        //and plays on to the recorded end
+        ReplayPlayer::play(reader, seeked);
+        assert(reader.is_valid());
+        assert(seeked.get_hash() == reader.hash() && seeked.get_score() == reader.score());
+    }
+    TetrisGame past(header.queue());
+    assert(!reader.seek(reader.steps() + 1, past));
+}
+
+//taken cells of every row, the falling figure included, as is_free() sees them
+template <class Game>
+void taken_cells(Game& game, uint64_t* taken) {
+    for (int i = 0; i < game.get_field_rows(); ++i) {
+        taken[i] = 0;
+        for (int j = 1; j + 1 < game.get_field_cols(); ++j) {
+            if (!game.is_free(i, j)) {
+                taken[i] |= 1ull << j;
+            }
+        }
+    }
+}
+
+//plays random inputs, or the inputs of `bot` with a tick now and then when there is one
+template <class Game>
+int ensure_tick_results_track_cells(Game& game, unsigned seed, BeamSearchBot* bot) {
+    StdLibRandomProvider inputs(seed);
+    BotMove plan;
+    plan.length = 0;
+    int step = 0;
+    uint64_t planned = 0;
+    uint64_t view[MAX_FIELD_ROWS];
+    uint64_t taken[MAX_FIELD_ROWS];
+    taken_cells(game, view);
+    tick_result out;
+    int locks = 0;
+    int clears = 0;
+    for (int k = 0; k < 5000; ++k) {
+        uint64_t before = game.get_hash();
+        bool moved = true;
+        ProcessResult result = MOVE;
+        int input = inputs.next_int(6);
+        if (bot && input != 0) {
+            //gravity moved the figure off the plan
+            if (step >= plan.length || planned != game.get_hash()) {
+                bot->think((const TetrisGame&) game, plan);
+                step = 0;
+            }
+            //the cases below by GameInput
+            static const int cases[] = {1, 2, 3, 0, 4};
+            input = cases[plan.inputs[step++]];
+        }
+        switch (input) {
+            case 1: moved = game.rotate(out);
+                break;
+            case 2: moved = game.move_left(out);
+                break;
+            case 3: moved = game.move_right(out);
+                break;
+            case 4: result = game.drop(out);
+                break;
+            default: result = game.process(out);
+        }
+        assert(out.result == result && out.moved == moved);
+        assert(moved || (out.changed_rows == 0 && before == game.get_hash()));
+        for (uint64_t rest = out.changed_rows; rest; rest &= rest - 1) {
+            int i = __builtin_ctzll(rest);
+            assert(out.vacated[i] || out.occupied[i]);
+            assert((view[i] & out.vacated[i]) == out.vacated[i] && !(view[i] & out.occupied[i]));
+            view[i] = (view[i] & ~out.vacated[i]) | out.occupied[i];
+        }
+        taken_cells(game, taken);
+        assert(std::equal(view, view + game.get_field_rows(), taken));
+        assert(out.cleared == (result == DESTROY ? game.get_cleared() : 0));
+        if (out.locked) {
+            locks++;
+            assert(result != MOVE);
+        }
+        assert(out.spawned == (result == DROP || result == DESTROY ? FigureTable::find_id(game.get_figure()) : 0));
+        clears += out.cleared != 0;
+        planned = game.get_hash();
+        if (result == GAME_OVER) {
+            break;
+        }
+    }
+    assert(locks >= 10);
+    return clears;
+}
+
+void test_tick_results_track_cells() {
+    for (unsigned seed = 1; seed <= 10; ++seed) {
+        PieceQueue pieces(seed);
+        TetrisGame game(pieces);
+        ensure_tick_results_track_cells(game, seed, 0);
+        BasicTetrisGame<GAME_FIELD_ROWS, 42> wide(pieces);
+        ensure_tick_results_track_cells(wide, seed, 0);
+    }
+    BotConfig config;
+    config.width = 4;
+    config.threads = 1;
+    BeamSearchBot bot(config);
+    PieceQueue pieces(3);
+    TetrisGame game(pieces);
+    assert(ensure_tick_results_track_cells(game, 3, &bot) > 10);
+}
+
+void test_event_bus_reports_game_events() {
+    EventBus bus;
+    EventRing* log = bus.subscribe();
+    EventRing* slow = bus.subscribe(4);
+    assert(bus.subscribers() == 2 && slow->capacity() == 4);
+    PieceQueue pieces(6);
+    TetrisGame game(pieces);
+    game.set_events(&bus);
+
+    BotConfig config;
+    config.width = 4;
+    config.threads = 1;
+    BeamSearchBot bot(config);
+    BotMove move;
+    uint64_t published = 0;
+    int clears = 0;
+    bool over = false;
+    for (int p = 0; p < 200 && !over && bot.think(game, move); ++p) {
+        int8_t figure = (int8_t) FigureTable::find_id(game.get_figure());
+        ProcessResult result = game.apply(move.target);
+        over = result == GAME_OVER;
+
+        game_event e;
+        assert(log->pop(e) && e.type == EVENT_LOCKED);
+        assert(e.figure == figure && e.rotation == move.target.rotation);
+        assert(e.row == move.target.row && e.col == move.target.col);
+        published++;
+        if (result == DESTROY) {
+            assert(log->pop(e) && e.type == EVENT_CLEARED);
+            assert(e.rows == game.get_cleared() && e.score == game.get_score());
+            published++;
+            clears++;
+        }
+        assert(log->pop(e) && e.type == (over ? EVENT_GAME_OVER : EVENT_SPAWNED));
+        assert(over || e.figure == FigureTable::find_id(game.get_figure()));
+        published++;
+        assert(!log->pop(e));
+    }
+    assert(clears > 10);
+
+    subscriber_stats a = log->stats();
+    assert(a.delivered == published && a.dropped == 0 && a.max_lag <= 3);
+    //the slow subscriber never read, it kept the first events and lost the rest
+    subscriber_stats b = slow->stats();
+    assert(b.delivered == 4 && b.dropped == published - 4 && b.max_lag == 4);
+    assert(slow->lag() == 4);
+    game_event e;
+    assert(slow->pop(e) && e.type == EVENT_LOCKED);
+}
+
+void test_event_ring_crosses_threads() {
+    EventRing ring(64);
+    const uint64_t count = 200000;
+    std::vector<uint64_t> received;
+    std::thread consumer([&ring, &received, count]() {
+        game_event e;
+        while (received.empty() || received.back() != count - 1) {
+            if (ring.pop(e)) {
+                received.push_back(e.rows);
+            }
+        }
+    });
+    game_event e = game_event();
+    for (uint64_t k = 0; k < count; ++k) {
+        e.rows = k;
+        //the last one has to arrive
+        while (!ring.push(e) && k == count - 1);
+    }
+    consumer.join();
+    subscriber_stats stats = ring.stats();
+    assert(stats.delivered == received.size());
+    assert(stats.delivered + stats.dropped >= count);
+    for (size_t k = 1; k < received.size(); ++k) {
+        assert(received[k] > received[k - 1]);
+    }
+}
+
+struct triple_buffer_value {
+    uint64_t value;
+    uint64_t check[15];
+};
+
+void test_triple_buffer_hands_over_latest() {
+    TripleBuffer<triple_buffer_value> buffer;
+    const uint64_t count = 200000;
+    buffer.back() = triple_buffer_value();
+    buffer.publish();
+    std::thread writer([&buffer, count]() {
+        for (uint64_t k = 1; k <= count; ++k) {
+            triple_buffer_value& v = buffer.back();
+            v.value = k;
+            for (int c = 0; c < 15; ++c) {
+                v.check[c] = k * (c + 1);
+            }
+            buffer.publish();
+        }
+    });
+    uint64_t last = 0;
+    while (last != count) {
+        const triple_buffer_value& v = buffer.read();
+        //never torn and never older than a value read before
+        for (int c = 0; c < 15; ++c) {
+            assert(v.check[c] == v.value * (c + 1));
+        }
+        assert(v.value >= last);
+        last = v.value;
+    }
+    writer.join();
+    assert(buffer.read().value == count);
+}
+
+void test_simulation_ticks_at_fixed_rate() {
+    PieceQueue pieces(11);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.tick_rate = 60;
+    config.gravity_ticks = 2;
+    config.max_catch_up = 3;
+    Simulation sim(game, config);
+    int row = game.get_row();
+    int col = game.get_col();
+
+    assert(sim.advance(0.5 / 60) == 0);
+    assert(sim.snapshot().tick == 0);
+    sim.input(INPUT_LEFT);
+    assert(sim.advance(0.6 / 60) == 1);
+    const board_snapshot& moved = sim.snapshot();
+    assert(moved.tick == 1 && moved.col == col - 1 && moved.row == row);
+    assert(moved.last_col == col && moved.last_row == row);
+
+    //gravity every second tick
+    assert(sim.advance(1.0 / 60) == 1);
+    const board_snapshot& fell = sim.snapshot();
+    assert(fell.row == row + 1 && fell.last_row == row && fell.last_col == col - 1);
+
+    //a stall runs the catch up limit and drops the rest
+    assert(sim.advance(10.0 / 60) == 3);
+    assert(sim.ticks() == 5 && sim.dropped_ticks() == 7);
+    const board_snapshot& s = sim.snapshot();
+    assert(s.tick == 5 && s.row == row + 2 && s.row == game.get_row());
+    assert(s.figure == FigureTable::find_id(game.get_figure()) && s.score == game.get_score());
+    assert(s.field_rows == GAME_FIELD_ROWS && s.field_cols == GAME_FIELD_COLS);
+    for (int i = 0; i < s.field_rows; ++i) {
+        assert(s.rows[i] == game.get_rows()[i]);
+    }
+    float alpha = sim.interpolation(s);
+    assert(alpha >= 0 && alpha <= 1);
+}
+
+void test_simulation_runs_on_its_thread() {
+    PieceQueue pieces(12);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.tick_rate = 1000;
+    config.gravity_ticks = 1;
+    Simulation sim(game, config);
+    sim.start();
+    assert(sim.is_running());
+    uint64_t seen = 0;
+    while (sim.ticks() < 200) {
+        const board_snapshot& s = sim.snapshot();
+        assert(s.tick >= seen);
+        seen = s.tick;
+        sim.input(INPUT_ROTATE);
+        std::this_thread::yield();
+    }
+    sim.stop();
+    assert(!sim.is_running());
+    const board_snapshot& s = sim.snapshot();
+    assert(s.tick == sim.ticks() && s.score == game.get_score());
+}
+
+void test_simulation_plays_keys_in_time() {
+    PieceQueue pieces(13);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.gravity_ticks = 0;
+    config.max_catch_up = 100;
+    config.das = 0.1;
+    config.arr = 0.025;
+    Simulation sim(game, config);
+    int row = game.get_row();
+    int col = game.get_col();
+
+    //left and right within one tick, right comes last
+    sim.press(INPUT_LEFT, 0.001);
+    sim.release(INPUT_LEFT, 0.002);
+    sim.press(INPUT_RIGHT, 0.003);
+    sim.release(INPUT_RIGHT, 0.004);
+    sim.press(INPUT_DOWN, 0.005);
+    sim.release(INPUT_DOWN, 0.19);
+    sim.press(INPUT_ROTATE, 0.5);
+    assert(sim.advance(1.0 / 60) == 1);
+    const board_snapshot& first = sim.snapshot();
+    assert(first.col == col && first.row == row + 1);
+    assert(first.keys == 3 && first.key_time == 0.001);
+
+    //down repeats 0.1 after the press, then every 0.025 until the release
+    assert(sim.advance(5.0 / 60) == 5);
+    assert(sim.snapshot().row == row + 1 && sim.snapshot().key_time < 0);
+    assert(sim.advance(1.0 / 60) == 1);
+    assert(sim.snapshot().row == row + 2 && sim.snapshot().keys == 3);
+    assert(sim.advance(10.0 / 60) == 10);
+    assert(sim.snapshot().row == row + 5);
+
+    //the rotation waits for its tick
+    assert(game.get_rotation() == first.rotation);
+    assert(sim.advance(14.0 / 60) == 14);
+    assert(sim.snapshot().keys == 4 && sim.snapshot().key_time == 0.5);
+    assert(sim.snapshot().row == row + 5);
+}
+
+template <int Rows, int Cols>
+void ensure_simulation_snapshots_well(int rows, int cols) {
+    PieceQueue pieces(14);
+    BasicTetrisGame<Rows, Cols> game(pieces, rows, cols);
+    SimulationConfig config;
+    config.gravity_ticks = 0;
+    config.max_catch_up = 1000;
+    BasicSimulation<Rows, Cols> sim(game, config);
+    for (int k = 0; k < 30; ++k) {
+        sim.input(k % 3 ? INPUT_RIGHT : INPUT_DROP);
+        sim.advance(1.0 / 60);
+    }
+    const board_snapshot& s = sim.snapshot();
+    assert(s.field_rows == rows && s.field_cols == cols);
+    assert(s.tick == 30 && s.col == game.get_col());
+    for (int i = 0; i < rows; ++i) {
+        assert(s.rows[i] == game.get_rows()[i]);
+    }
+}
+
+void test_simulation_snapshots_wells_of_other_sizes() {
+    ensure_simulation_snapshots_well<GAME_FIELD_ROWS, 42>(GAME_FIELD_ROWS, 42);
+    ensure_simulation_snapshots_well<42, GAME_FIELD_COLS>(42, GAME_FIELD_COLS);
+    ensure_simulation_snapshots_well<DYNAMIC_SIZE, DYNAMIC_SIZE>(MAX_FIELD_ROWS, MAX_FIELD_COLS);
+}
+
+void test_simulation_stamps_changed_rows() {
+    PieceQueue pieces(15);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.gravity_ticks = 0;
+    config.max_catch_up = 1000;
+    Simulation sim(game, config);
+
+    //a move changes no locked cell, a drop only the rows of the figure
+    sim.input(INPUT_LEFT);
+    sim.advance(1.0 / 60);
+    const board_snapshot& moved = sim.snapshot();
+    for (int i = 0; i < moved.field_rows; ++i) {
+        assert(moved.row_ticks[i] == 0);
+    }
+    sim.input(INPUT_DROP);
+    sim.advance(1.0 / 60);
+    const board_snapshot& dropped = sim.snapshot();
+    int stamped = 0;
+    for (int i = 0; i < dropped.field_rows; ++i) {
+        stamped += dropped.row_ticks[i] == dropped.tick;
+        assert(dropped.row_ticks[i] == dropped.tick || dropped.row_ticks[i] == 0);
+    }
+    assert(stamped > 0 && stamped <= GEOMETRY_SIZE);
+
+    //a reader that skips snapshots and copies the stamped rows only keeps up with the board
+    uint64_t rows[MAX_FIELD_ROWS] = {0};
+    uint64_t seen[MAX_FIELD_ROWS];
+    for (int i = 0; i < MAX_FIELD_ROWS; ++i) {
+        seen[i] = ~0ull;
+    }
+    BeamSearchBot bot;
+    BotMove move;
+    move.length = 0;
+    int step = 0;
+    for (int k = 0; k < 600 && game.get_figure(); ++k) {
+        //the bot clears rows, which moves the ones above
+        if (step == move.length) {
+            assert(bot.think(game, move));
+            step = 0;
+        }
+        sim.input((GameInput) move.inputs[step++]);
+        sim.advance(1.0 / 60);
+        if (k % 3) {
+            continue;
+        }
+        const board_snapshot& s = sim.snapshot();
+        for (int i = 0; i < s.field_rows; ++i) {
+            if (s.row_ticks[i] != seen[i]) {
+                rows[i] = s.rows[i];
+                seen[i] = s.row_ticks[i];
+            }
+            assert(rows[i] == s.rows[i]);
+        }
+    }
+    assert(game.get_score() > 0);
+}
+
+//hands tick results to the simulation as if the game thread played them
+class TrackingSimulation : public Simulation {
+public:
+    TrackingSimulation(TetrisGame& game, const SimulationConfig& config) : Simulation(game, config) {
+    }
+
+    using Simulation::track;
+};
+
+void test_simulation_stamps_rows_shifted_by_clears() {
+    PieceQueue pieces(17);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.gravity_ticks = 0;
+    TrackingSimulation sim(game, config);
+
+    //a clear the spawned figure covers up reports no shifted row, they changed all the same
+    tick_result out;
+    out.result = DESTROY;
+    out.changed_rows = 0;
+    out.cleared = 1ull << (GAME_FIELD_ROWS - 3);
+    out.locked = (int8_t) FigureTable::find_id(game.get_figure());
+    out.locked_rotation = 0;
+    out.locked_row = 0;
+    out.locked_col = 1;
+    sim.track(out);
+    sim.advance(1.0 / 60);
+    const board_snapshot& s = sim.snapshot();
+    for (int i = 0; i < s.field_rows; ++i) {
+        assert(s.row_ticks[i] == (i <= GAME_FIELD_ROWS - 3 ? 1u : 0u));
+    }
+}
+
+void test_simulation_stops_at_game_over() {
+    PieceQueue pieces(16);
+    TetrisGame game(pieces);
+    SimulationConfig config;
+    config.gravity_ticks = 1;
+    config.max_catch_up = 1000;
+    Simulation sim(game, config);
+    for (int k = 0; k < 200 && !sim.is_over(); ++k) {
+        sim.input(INPUT_DROP);
+        sim.advance(1.0 / 60);
+    }
+    assert(sim.is_over() && !game.get_figure());
+    uint64_t hash = game.get_hash();
+    int score = game.get_score();
+    const figure_shape* next[MAX_PREVIEW];
+    int previews = game.get_preview(next, MAX_PREVIEW);
+
+    //held keys, their repeats and gravity leave the finished game alone, no piece is dealt
+    sim.press(INPUT_DOWN, sim.ticks() / 60.0);
+    sim.press(INPUT_LEFT, sim.ticks() / 60.0);
+    sim.input(INPUT_DROP);
+    assert(sim.advance(60.0 / 60) == 60);
+    assert(!game.get_figure() && game.get_hash() == hash && game.get_score() == score);
+    const figure_shape* after[MAX_PREVIEW];
+    assert(game.get_preview(after, MAX_PREVIEW) == previews);
+    for (int k = 0; k < previews; ++k) {
+        assert(after[k] == next[k]);
+    }
+    assert(sim.snapshot().figure == 0);
+}
+
+void test_latency_histogram_reports_percentiles() {
+    LatencyHistogram h(0.001, 0.25);
+    assert(h.count() == 0 && h.percentile(0.5) == 0);
+    for (int k = 1; k <= 100; ++k) {
+        h.record(k * 0.001 - 0.0005);
+    }
+    assert(h.count() == 100);
+    assert(std::abs(h.percentile(0.5) - 0.050) < 1e-9);
+    assert(std::abs(h.percentile(0.99) - 0.099) < 1e-9);
+    assert(std::abs(h.max() - 0.0995) < 1e-9);
+    //past the last bucket only the largest sample is known
+    h.record(2.0);
+    assert(h.percentile(1) == 2.0 && h.max() == 2.0);
+    h.clear();
+    assert(h.count() == 0 && h.max() == 0);
+}
+
 void memTest() {
     TetrisGame game(rnd_provider);
     for (int i = 0; i < 10000; ++i) {
@@ -428,7 +1911,62 @@ void memTest() {
     }
 }
 
+void test_game_does_not_allocate() {
+    replay_header header(21);
+    TetrisGame recorded(header.queue());
+    ReplayWriter writer(header);
+    std::vector<GameInput> played;
+    play_bot_recorded(recorded, writer, played, 300, 3);
+
+    TetrisGame game(header.queue());
+    EventBus bus;
+    EventRing* ring = bus.subscribe();
+    game.set_events(&bus);
+    tick_result result;
+    game_event e;
+    //the counter sees allocations at all
+    start_counting_allocations();
+    std::vector<int> one(1);
+    assert(stop_counting_allocations() == 1);
+
+    start_counting_allocations();
+    for (size_t k = 0; k < played.size(); ++k) {
+        //every other input reports what it changed
+        switch (k % 2 ? played[k] : -1) {
+            case INPUT_ROTATE: game.rotate(result);
+                break;
+            case INPUT_LEFT: game.move_left(result);
+                break;
+            case INPUT_RIGHT: game.move_right(result);
+                break;
+            case INPUT_DOWN: game.process(result);
+                break;
+            case INPUT_DROP: game.drop(result);
+                break;
+            default: play_input(game, played[k]);
+        }
+        while (ring->pop(e));
+    }
+    memTest();
+    assert(stop_counting_allocations() == 0);
+    assert(game.get_hash() == recorded.get_hash() && game.get_score() > 0);
+
+    PieceQueue pieces(22);
+    TetrisGame ticked(pieces);
+    Simulation sim(ticked);
+    start_counting_allocations();
+    for (int k = 0; k < 600; ++k) {
+        sim.press((GameInput) (k % SIMULATION_KEYS), k / 60.0);
+        sim.release((GameInput) (k % SIMULATION_KEYS), k / 60.0 + 0.01);
+        sim.advance(1.0 / 60);
+        sim.snapshot();
+    }
+    assert(stop_counting_allocations() == 0);
+    assert(sim.ticks() == 600);
+}
+
 void runTests() {
+    test_figure_table_matches_authored_figures();
     test_figure1_rotates_well();
     test_figure2_rotates_well();
     test_figure3_rotates_well();
@@ -451,5 +1989,47 @@ void runTests() {
     test_move_bottom_well_if_on_left_bound();
     test_game_overs_when_spawn_failed();
     test_full_row_get_destroyed();
-    //    memTest();
+    test_batch_does_not_depend_on_threads();
+    test_batch_plays_like_games();
+    test_finds_placements_of_square();
+    test_finds_placements_of_stick();
+    test_finds_placements_on_rough_board();
+    test_undo_restores_game();
+    test_undo_takes_back_figures_not_dealt();
+    test_spawns_every_figure();
+    test_piece_queue_deals_bags();
+    test_piece_queue_previews_and_rewinds();
+    test_game_previews_figures_of_queue();
+    test_philox_matches_known_answers();
+    test_pieces_are_random_access();
+    test_tracks_board_features();
+    test_clears_rows_apart();
+    test_hash_does_not_depend_on_move_order();
+    test_hash_matches_recompute();
+    test_transposition_table_stores_and_probes();
+    test_transposition_table_keeps_deeper_entries();
+    test_transposition_table_is_never_torn();
+    test_wells_of_other_sizes_play_like_dynamic_ones();
+    test_clears_rows_of_wide_well();
+    test_bot_clears_rows();
+    test_bot_does_not_depend_on_threads();
+    test_bot_searches_known_figures_and_one_more();
+    test_bot_plays_wells_of_other_sizes();
+    test_replay_plays_back_inputs();
+    test_replay_packs_bot_placements();
+    test_replay_detects_tampering();
+    test_replay_seeks_through_keyframes();
+    test_tick_results_track_cells();
+    test_event_bus_reports_game_events();
+    test_event_ring_crosses_threads();
+    test_triple_buffer_hands_over_latest();
+    test_simulation_ticks_at_fixed_rate();
+    test_simulation_runs_on_its_thread();
+    test_simulation_plays_keys_in_time();
+    test_simulation_snapshots_wells_of_other_sizes();
+    test_simulation_stamps_changed_rows();
+    test_simulation_stamps_rows_shifted_by_clears();
+    test_simulation_stops_at_game_over();
+    test_latency_histogram_reports_percentiles();
+    test_game_does_not_allocate();
 }
@@ -0,0 +1,162 @@
+/*
+ Headless batch runner, simulates many games without opening a window.
+
+ usage: batch [games] [max_ticks] [seed] [threads] [games|lockstep|bot|sizes]
+
+ `games` runs every game on its own through BatchSimulator, `lockstep` steps
+ all of them together as one TetrisBatch on the calling thread, `bot` plays
+ the games one after another with BeamSearchBot searching on `threads`
+ threads, `max_ticks` then limits the placements per game. `sizes` plays
+ the games on wells of every instantiated size, once with the dimensions as
+ template arguments and once given at run time, on the calling thread.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../game/BatchSimulator.h"
+#include "../game/TetrisBatch.h"
+#include "../game/BeamSearchBot.h"
+#include "../game/StdLibRandomProvider.h"
+
+static void run_games(const BatchConfig& config) {
+    BatchSimulator simulator(config);
+    BatchReport report = simulator.run();
+
+    std::cout << "games: " << report.games
+            << " (" << report.game_overs << " game over)" << std::endl;
+    std::cout << "ticks: " << report.ticks << std::endl;
+    std::cout << "seconds: " << report.seconds << std::endl;
+    std::cout << "games/sec: " << report.games_per_second() << std::endl;
+    std::cout << "ticks/sec: " << report.ticks_per_second() << std::endl;
+    std::cout << "score min/mean/max/stddev: "
+            << report.min_score << " / "
+            << report.mean_score << " / "
+            << report.max_score << " / "
+            << report.stddev_score << std::endl;
+}
+
+static void run_lockstep(const BatchConfig& config) {
+    static const char* kernels[] = {"scalar", "sse2", "avx2"};
+    TetrisBatch batch(config.games, config.seed);
+    std::vector<uint8_t> actions(config.games);
+    unsigned state = config.seed | 1;
+    long long ticks = 0;
+    int steps = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    while (steps < config.max_ticks && batch.alive() > 0) {
+        for (auto & a : actions) {
+            //xorshift32, one random action per board
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            a = (uint8_t) (state % 6 < 4 ? (BatchAction) (state % 6) : ACTION_NONE);
+        }
+        ticks += batch.alive();
+        batch.step(&actions[0]);
+        steps++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "boards: " << batch.size() << " (" << kernels[batch.kernel()] << ")" << std::endl;
+    std::cout << "steps: " << steps << std::endl;
+    std::cout << "board ticks: " << ticks << std::endl;
+    std::cout << "seconds: " << seconds << std::endl;
+    std::cout << "board ticks/sec: " << (seconds > 0 ? ticks / seconds : 0) << std::endl;
+}
+
+static void run_bot(const BatchConfig& config) {
+    BotConfig bot_config;
+    bot_config.threads = config.threads;
+    BeamSearchBot bot(bot_config);
+    BotMove move;
+    long long placements = 0;
+    long long score = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (int g = 0; g < config.games; ++g) {
+        TetrisGame game(PieceQueue(config.seed, g));
+        const figure_shape* preview[MAX_PREVIEW];
+        for (int p = 0; p < config.max_ticks; ++p) {
+            if (!bot.think(game, move, preview, game.get_preview(preview, MAX_PREVIEW))) {
+                break;
+            }
+            placements++;
+            if (GAME_OVER == game.apply(move.target)) {
+                break;
+            }
+        }
+        score += game.get_score();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "games: " << config.games << std::endl;
+    std::cout << "placements: " << placements << std::endl;
+    std::cout << "seconds: " << seconds << std::endl;
+    std::cout << "placements/sec: " << (seconds > 0 ? placements / seconds : 0) << std::endl;
+    std::cout << "mean score: " << (config.games > 0 ? (double) score / config.games : 0) << std::endl;
+}
+
+template <class Game>
+static double ticks_per_second(const BatchConfig& config, int rows, int cols) {
+    long long ticks = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int g = 0; g < config.games; ++g) {
+        StdLibRandomProvider inputs(BatchSimulator::game_seed(~config.seed, g));
+        Game game(PieceQueue(config.seed, g), rows, cols);
+        for (int tick = 0; tick < config.max_ticks; ++tick) {
+            switch (inputs.next_int(6)) {
+                case 1: game.rotate();
+                    break;
+                case 2: game.move_left();
+                    break;
+                case 3: game.move_right();
+                    break;
+            }
+            ticks++;
+            if (GAME_OVER == game.process()) {
+                break;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return seconds > 0 ? ticks / seconds : 0;
+}
+
+template <int Rows, int Cols>
+static void run_size(const BatchConfig& config) {
+    double fixed = ticks_per_second<BasicTetrisGame<Rows, Cols> >(config, Rows, Cols);
+    double dynamic = ticks_per_second<DynamicTetrisGame>(config, Rows, Cols);
+    std::cout << Rows << "x" << Cols << " ticks/sec: "
+            << fixed << " template, " << dynamic << " dynamic" << std::endl;
+}
+
+static void run_sizes(const BatchConfig& config) {
+    run_size<GAME_FIELD_ROWS, GAME_FIELD_COLS>(config);
+    run_size<GAME_FIELD_ROWS, 18>(config);
+    run_size<GAME_FIELD_ROWS, 42>(config);
+    run_size<42, GAME_FIELD_COLS>(config);
+}
+
+int main(int argc, char *argv[]) {
+    BatchConfig config;
+    if (argc > 1) config.games = std::atoi(argv[1]);
+    if (argc > 2) config.max_ticks = std::atoi(argv[2]);
+    if (argc > 3) config.seed = (unsigned) std::atoi(argv[3]);
+    if (argc > 4) config.threads = std::atoi(argv[4]);
+
+    if (argc > 5 && !std::strcmp(argv[5], "lockstep")) {
+        run_lockstep(config);
+    } else if (argc > 5 && !std::strcmp(argv[5], "sizes")) {
+        run_sizes(config);
+    } else if (argc > 5 && !std::strcmp(argv[5], "bot")) {
+        run_bot(config);
+    } else {
+        run_games(config);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/*
+ Headless replay tool, records bot games and verifies replays without opening a window.
+
+ usage: replay record [prefix] [games] [pieces] [seed]
+        replay verify file...
+        replay show file step
+
+ `record` plays `games` games with BeamSearchBot, at most `pieces` figures
+ each, and saves game g as <prefix><g>.trp. `verify` maps every file, plays
+ it back on all hardware threads and checks that it ends on the recorded
+ hash and score, the exit code tells whether all of them did. `show` seeks
+ to a step of a replay, an input or a tick, and prints the board there.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../game/Replay.h"
+#include "../game/MappedFile.h"
+#include "../game/BeamSearchBot.h"
+#include "../game/ThreadPool.h"
+
+static int record(const char* prefix, int games, int pieces, unsigned seed) {
+    BeamSearchBot bot;
+    BotMove move;
+    long long placed = 0;
+    long long bytes = 0;
+
+    for (int g = 0; g < games; ++g) {
+        replay_header header(seed, g);
+        TetrisGame game(header.queue());
+        ReplayWriter writer(header);
+        bool over = false;
+        const figure_shape* preview[MAX_PREVIEW];
+        for (int p = 0; p < pieces && !over; ++p) {
+            if (!bot.think(game, move, preview, game.get_preview(preview, MAX_PREVIEW))) {
+                break;
+            }
+            for (int k = 0; k < move.length && !over; ++k) {
+                over = GAME_OVER == writer.play(game, (GameInput) move.inputs[k]);
+            }
+            placed++;
+        }
+        writer.finish(game.get_hash(), game.get_score());
+
+        std::ostringstream path;
+        path << prefix << g << ".trp";
+        if (!writer.save(path.str().c_str())) {
+            std::cerr << "can not write " << path.str() << std::endl;
+            return EXIT_FAILURE;
+        }
+        bytes += writer.data().size();
+    }
+
+    std::cout << "games: " << games << std::endl;
+    std::cout << "placements: " << placed << std::endl;
+    std::cout << "bytes: " << bytes << std::endl;
+    std::cout << "bytes/placement: " << (placed > 0 ? (double) bytes / placed : 0) << std::endl;
+    return EXIT_SUCCESS;
+}
+
+static int verify(char** paths, int count) {
+    ThreadPool pool;
+    std::vector<replay_result> results(count);
+
+    auto started = std::chrono::steady_clock::now();
+    pool.parallel_for(0, count, 1, [paths, &results](int begin, int end, int) {
+        for (int k = begin; k < end; ++k) {
+            results[k] = ReplayPlayer::verify(paths[k]);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    int failed = 0;
+    long long steps = 0;
+    for (int k = 0; k < count; ++k) {
+        steps += results[k].inputs + results[k].ticks;
+        if (!results[k].verified) {
+            failed++;
+            std::cout << paths[k] << ": " << (results[k].valid ? "hash mismatch" : "invalid") << std::endl;
+        }
+    }
+    std::cout << "replays: " << count << " (" << failed << " failed)" << std::endl;
+    std::cout << "inputs: " << steps << std::endl;
+    std::cout << "seconds: " << seconds << std::endl;
+    std::cout << "inputs/sec: " << (seconds > 0 ? steps / seconds : 0) << std::endl;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int show(const char* path, long long step) {
+    MappedFile file(path);
+    ReplayReader reader(file.data(), file.size());
+    const replay_header& header = reader.header();
+    if (!reader.is_valid()) {
+        std::cerr << path << ": invalid" << std::endl;
+        return EXIT_FAILURE;
+    }
+    DynamicTetrisGame game(header.queue(), header.rows, header.cols);
+    auto started = std::chrono::steady_clock::now();
+    if (!reader.seek(step, game)) {
+        std::cerr << path << ": no step " << step << " of " << reader.steps() << std::endl;
+        return EXIT_FAILURE;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    game.debug();
+    std::cout << "step: " << reader.position() << " of " << reader.steps()
+            << " (" << reader.keyframes() << " keyframes)" << std::endl;
+    std::cout << "score: " << game.get_score() << std::endl;
+    std::cout << "hash: " << std::hex << game.get_hash() << std::dec << std::endl;
+    std::cout << "seek seconds: " << seconds << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && !std::strcmp(argv[1], "record")) {
+        return record(argc > 2 ? argv[2] : "replay",
+                argc > 3 ? std::atoi(argv[3]) : 10,
+                argc > 4 ? std::atoi(argv[4]) : 1000,
+                argc > 5 ? (unsigned) std::atoi(argv[5]) : 1);
+    }
+    if (argc > 2 && !std::strcmp(argv[1], "verify")) {
+        return verify(argv + 2, argc - 2);
+    }
+    if (argc > 3 && !std::strcmp(argv[1], "show")) {
+        return show(argv[2], std::atoll(argv[3]));
+    }
+    std::cerr << "usage: replay record [prefix] [games] [pieces] [seed]" << std::endl;
+    std::cerr << "       replay verify file..." << std::endl;
+    std::cerr << "       replay show file step" << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,18 @@
+/*
+ Runs the game tests, built by the test target of the makefile.
+
+ usage: tests
+
+ A failing test stops the run on its assertion, the exit code is 0 when
+ all of them passed.
+ */
+
+#include <iostream>
+
+#include "../game/test.h"
+
+int main() {
+    runTests();
+    std::cout << "all tests passed" << std::endl;
+    return 0;
+}
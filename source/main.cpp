@@ -25,21 +25,30 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // standard C++ libraries
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <stdexcept>
 #include <cmath>
+#include <cstring>
+#include <ctime>
 #include <list>
 
 // tdogl classes
 #include "tdogl/Program.h"
 #include "tdogl/Texture.h"
 #include "tdogl/Camera.h"
+#include "tdogl/UniformBuffer.h"
+#include "tdogl/RenderQueue.h"
+#include "tdogl/StreamBuffer.h"
 
 //game
 #include "game/TetrisGame.h"
-#include "game/StdLibRandomProvider.h"
-#include "game/test.h"
+#include "game/BeamSearchBot.h"
+#include "game/Replay.h"
+#include "game/MappedFile.h"
+#include "game/Simulation.h"
+#include "game/LatencyHistogram.h"
 
 /*
  Represents a textured geometry asset
@@ -51,6 +60,7 @@
   - a VBO
   - a VAO
   - the parameters to glDrawArrays (drawType, drawStart, drawCount)
+  - the attribute of the per instance offsets, read from gStream and drawn with glDrawArraysInstanced
  */
 struct ModelAsset {
     tdogl::Program* shaders;
@@ -60,6 +70,7 @@ struct ModelAsset {
     GLenum drawType;
     GLint drawStart;
     GLint drawCount;
+    GLint instanceAttrib;
 
     ModelAsset() :
     shaders(NULL),
@@ -68,7 +79,8 @@ struct ModelAsset {
     vao(0),
     drawType(GL_TRIANGLES),
     drawStart(0),
-    drawCount(0) {
+    drawCount(0),
+    instanceAttrib(-1) {
     }
 };
 
@@ -95,6 +107,21 @@ struct Light {
     glm::vec3 intensities; //a.k.a. the color of the light
 };
 
+/*
+ The "Frame" uniform block of the shaders, in std140 layout
+
+ Computed and uploaded once per frame, every program reads it through the
+ FRAME_UNIFORMS_BINDING binding point.
+ */
+struct FrameUniforms {
+    glm::mat4 camera;
+    glm::vec4 lightPosition;
+    glm::vec4 lightIntensities;
+    GLfloat time;
+    GLfloat padding[3];
+};
+#define FRAME_UNIFORMS_BINDING 0
+
 // constants
 const glm::vec2 SCREEN_SIZE(800, 600);
 
@@ -103,17 +130,69 @@ GLFWwindow* gWindow = NULL;
 double gScrollY = 0.0;
 tdogl::Camera gCamera;
 ModelAsset gWoodenCrate;
+//per object uniforms of the gWoodenCrate shaders, looked up once
+struct CrateUniforms {
+    tdogl::UniformHandle model;
+    tdogl::UniformHandle tex;
+};
+CrateUniforms gCrateUniforms;
+tdogl::UniformBuffer* gFrameUniforms = NULL;
+//the vertex data written every frame, the bytes a frame can write
+tdogl::StreamBuffer* gStream = NULL;
+#define STREAM_REGION_SIZE (256 * 1024)
+//--bench-stream times gStream against glBufferData instead of playing
+bool gBenchStream = false;
+#define BENCH_FRAMES 1000
+#define BENCH_BYTES (64 * 1024)
+//draws of the frame, issued sorted when it ends
+tdogl::RenderQueue gRenderQueue;
+tdogl::RenderState gRenderState;
+//state changes of all the frames so far
+tdogl::RenderStats gRenderTotals = tdogl::RenderStats();
+unsigned gFrames = 0;
 std::list<ModelInstance> gInstances;
 GLfloat gDegreesRotated = 0.0f;
 Light gLight;
-std::map<int, ModelInstance*> blocks;
-
-RandomNumberProvider* rnd_p = new StdLibRandomProvider();
-TetrisGame game(rnd_p);
+//model space offsets of the blocks drawn, the locked ones first, row after row
+std::vector<glm::vec3> gBlockOffsets;
+size_t gLockedBlocks = 0;
+//locked blocks of every row in gBlockOffsets, and the board_snapshot::row_ticks they are from
+int gRowBlocks[MAX_FIELD_ROWS] = {0};
+uint64_t gRowTicks[MAX_FIELD_ROWS];
+
+replay_header gReplayHeader(std::time(0));
+TetrisGame game(gReplayHeader.queue());
+//every input the game gets goes through the replay, saved to REPLAY_PATH on game over
+ReplayWriter gReplay(gReplayHeader);
+#define REPLAY_PATH "last_game.trp"
+
+//replay given on the command line, shown instead of a game, the arrows seek through it
+MappedFile* gViewerFile = NULL;
+ReplayReader* gViewer = NULL;
+#define VIEWER_SEEK_STEPS 500
+//steps asked for by the keys, the game thread seeks
+std::atomic<long long> gViewerSeek(0);
+
+EventBus gEvents;
+EventRing* gGameEvents = gEvents.subscribe();
+
+//runs the game, see GameThread; the frame loop only draws its snapshots
+Simulation* gSim = NULL;
+//seconds from a key press to the swap of the first frame showing it
+LatencyHistogram gLatency;
+uint64_t gShownKeys = 0;
 
 int old = 0;
 int wait_time = 0;
 
+//the bot plays instead of the keyboard while autoplay is on, B toggles it
+std::atomic<bool> gAutoplay(false);
+bool gBotPlaying = false;
+BeamSearchBot* gBot = NULL;
+BotMove gPlan;
+int gPlanStep = 0;
+uint64_t gPlanHash = 0;
+
 
 
 // returns a new tdogl::Program created from the given vertex and fragment shader filenames
@@ -122,7 +201,9 @@ static tdogl::Program* LoadShaders(const char* vertFilename, const char* fragFil
     std::vector<tdogl::Shader> shaders;
     shaders.push_back(tdogl::Shader::shaderFromFile(ResourcePath(vertFilename), GL_VERTEX_SHADER));
     shaders.push_back(tdogl::Shader::shaderFromFile(ResourcePath(fragFilename), GL_FRAGMENT_SHADER));
-    return new tdogl::Program(shaders);
+    tdogl::Program* program = new tdogl::Program(shaders);
+    program->bindUniformBlock("Frame", FRAME_UNIFORMS_BINDING);
+    return program;
 }
 
 
@@ -140,6 +221,12 @@ static tdogl::Texture* LoadTexture(const char* filename) {
 static void LoadWoodenCrateAsset() {
     // set all the elements of gWoodenCrate
     gWoodenCrate.shaders = LoadShaders("vertex-shader.txt", "fragment-shader.txt");
+    gCrateUniforms.model = gWoodenCrate.shaders->uniformHandle("model");
+    gCrateUniforms.tex = gWoodenCrate.shaders->uniformHandle("tex");
+    //the texture is always bound to GL_TEXTURE0
+    gWoodenCrate.shaders->use();
+    gWoodenCrate.shaders->setUniform(gCrateUniforms.tex, 0);
+    gWoodenCrate.shaders->stopUsing();
     gWoodenCrate.drawType = GL_TRIANGLES;
     gWoodenCrate.drawStart = 0;
     gWoodenCrate.drawCount = 6 * 2 * 3;
@@ -218,6 +305,15 @@ static void LoadWoodenCrateAsset() {
     glEnableVertexAttribArray(gWoodenCrate.shaders->attrib("vertNormal"));
     glVertexAttribPointer(gWoodenCrate.shaders->attrib("vertNormal"), 3, GL_FLOAT, GL_TRUE, 8 * sizeof (GLfloat), (const GLvoid*) (5 * sizeof (GLfloat)));
 
+    // the "instanceOffset" attribute advances once per instance, BindInstanceOffsets points it at the offsets of the frame
+    gWoodenCrate.instanceAttrib = gWoodenCrate.shaders->attrib("instanceOffset");
+    glEnableVertexAttribArray(gWoodenCrate.instanceAttrib);
+    if (GLEW_VERSION_3_3) {
+        glVertexAttribDivisor(gWoodenCrate.instanceAttrib, 1);
+    } else {
+        glVertexAttribDivisorARB(gWoodenCrate.instanceAttrib, 1);
+    }
+
     // unbind the VAO
     glBindVertexArray(0);
 }
@@ -237,51 +333,89 @@ glm::mat4 scale(GLfloat x, GLfloat y, GLfloat z) {
 }
 
 
-//create all the `instance` structs for the 3D scene, and add them to `gInstances`
+//points the instance attribute of `asset` at offsets starting `offset` bytes into `buffer`
 
-static void CreateInstances() {
-    ModelInstance* dot = new ModelInstance();
-    dot->asset = &gWoodenCrate;
-    dot->transform = glm::mat4();
-    blocks[0] = dot;
+static void BindInstanceOffsets(const ModelAsset& asset, GLuint buffer, GLintptr offset) {
+    gRenderState.bindVertexArray(asset.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(asset.instanceAttrib, 3, GL_FLOAT, GL_FALSE, sizeof (glm::vec3), (const GLvoid*) offset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
-//renders a single `ModelInstance`
+//writes the offsets to the region of the frame in gStream and binds them to `asset`
 
-static void RenderInstance(const ModelInstance& inst) {
-    ModelAsset* asset = inst.asset;
-    tdogl::Program* shaders = asset->shaders;
+static void StreamInstanceOffsets(const ModelAsset& asset, const std::vector<glm::vec3>& offsets) {
+    GLsizeiptr bytes = offsets.size() * sizeof (glm::vec3);
+    GLintptr offset;
+    GLvoid* p = gStream->map(bytes, offset);
+    //no blocks, nothing is mapped
+    if (bytes) {
+        memcpy(p, offsets.data(), bytes);
+    }
+    gStream->unmap();
+    BindInstanceOffsets(asset, gStream->object(), offset);
+}
 
-    //bind the shaders
-    shaders->use();
 
-    auto v = gCamera.matrix() * glm::lookAt(
-            glm::vec3(0, 0, 1.0), // Camera in World Space
-            glm::vec3(0, 0, 0), // and looks at the origin
-            glm::vec3(-1, 0, 0) // Head is up (set to 0,-1,0 to look upside-down)
-            );
-    v = glm::translate(v, glm::vec3(-24.0f, -7.0f, 0.0f));
+//queues `asset`, drawn once per offset bound by BindInstanceOffsets; the offsets place it
+
+static void RenderInstances(const ModelAsset& asset, GLsizei count) {
+    tdogl::DrawCommand c;
+    c.program = asset.shaders;
+    c.texture = asset.texture->object();
+    c.vao = asset.vao;
+    c.drawType = asset.drawType;
+    c.drawStart = asset.drawStart;
+    c.drawCount = asset.drawCount;
+    c.instances = count;
+    //the camera and the light are in gFrameUniforms
+    c.modelUniform = gCrateUniforms.model;
+    c.model = glm::mat4();
+    c.key = tdogl::RenderQueue::sortKey(c.program, c.texture, c.vao, 0.0f);
+    gRenderQueue.submit(c);
+}
 
-    //set the shader uniforms
-    shaders->setUniform("camera", v);
-    shaders->setUniform("model", inst.transform);
-    shaders->setUniform("tex", 0); //set to 0 because the texture will be bound to GL_TEXTURE0
-    shaders->setUniform("light.position", gLight.position);
-    shaders->setUniform("light.intensities", gLight.intensities);
 
-    //bind the texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, asset->texture->object());
+//model space offset of a block at cell (i, j) of the well, fractions fall between cells
 
-    //bind VAO and draw
-    glBindVertexArray(asset->vao);
-    glDrawArrays(asset->drawType, asset->drawStart, asset->drawCount);
+static glm::vec3 BlockOffset(float i, float j) {
+    return glm::vec3(i, j, 0.0) * 2.0f;
+}
 
-    //unbind everything
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    shaders->stopUsing();
+
+//adds a block at cell (i, j) of the well
+
+static void AddBlock(float i, float j) {
+    gBlockOffsets.push_back(BlockOffset(i, j));
+}
+
+
+//replaces the locked blocks of the rows that changed since the last snapshot drawn
+
+static void UpdateLockedBlocks(const board_snapshot& s) {
+    //from the bottom up, so that the blocks of the rows still to do stay where they are
+    for (int i = s.field_rows - 1; i >= 0; --i) {
+        if (s.row_ticks[i] == gRowTicks[i]) {
+            continue;
+        }
+        size_t start = 0;
+        for (int k = 0; k < i; ++k) {
+            start += gRowBlocks[k];
+        }
+        glm::vec3 row[MAX_FIELD_COLS];
+        int count = 0;
+        for (int j = 0; j < s.field_cols; ++j) {
+            if (s.rows[i] >> j & 1) {
+                row[count++] = BlockOffset((float) i, (float) j);
+            }
+        }
+        std::vector<glm::vec3>::iterator at = gBlockOffsets.begin() + start;
+        at = gBlockOffsets.erase(at, at + gRowBlocks[i]);
+        gBlockOffsets.insert(at, row, row + count);
+        gRowBlocks[i] = count;
+        gRowTicks[i] = s.row_ticks[i];
+    }
 }
 
 
@@ -292,43 +426,243 @@ static void Render() {
     glClearColor(0, 0, 0, 1); // black
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    //the constants of the frame, shared by all the draws
+    FrameUniforms frame;
+    frame.camera = gCamera.matrix() * glm::lookAt(
+            glm::vec3(0, 0, 1.0), // Camera in World Space
+            glm::vec3(0, 0, 0), // and looks at the origin
+            glm::vec3(-1, 0, 0) // Head is up (set to 0,-1,0 to look upside-down)
+            );
+    frame.camera = glm::translate(frame.camera, glm::vec3(-24.0f, -7.0f, 0.0f));
+    frame.lightPosition = glm::vec4(gLight.position, 1);
+    frame.lightIntensities = glm::vec4(gLight.intensities, 1);
+    frame.time = (GLfloat) glfwGetTime();
+    gFrameUniforms->update(&frame);
+
     //    // render all the instances
     //    std::list<ModelInstance>::const_iterator it;
     //    for(it = gInstances.begin(); it != gInstances.end(); ++it){
     //        RenderInstance(*it);
     //    }
 
-    for (int j = 0; j < GAME_FIELD_COLS; ++j) {
-        for (int i = 0; i < GAME_FIELD_ROWS; ++i) {
-            if (!game.is_free(i, j)) {
-                glm::mat4 Model = glm::mat4(1.0f);
-                Model = glm::translate(Model, glm::vec3(i, j, 0.0) * 2.0f);
-                //ModelInstance* m = blocks[std::ceil(game.get_color(i, j).w)];
-                ModelInstance* m = blocks[0];
-                ModelInstance r;
-                r.asset = m->asset;
-                r.transform = Model;
-                RenderInstance(r);
+    //the locked blocks change with the ticks only, the falling figure every frame
+    const board_snapshot& s = gSim->snapshot();
+    gBlockOffsets.resize(gLockedBlocks);
+    UpdateLockedBlocks(s);
+    gLockedBlocks = gBlockOffsets.size();
+
+    //the falling figure slides from where it was a tick ago
+    if (s.figure) {
+        float alpha = gSim->interpolation(s);
+        float row = s.last_row + (s.row - s.last_row) * alpha;
+        float col = s.last_col + (s.col - s.last_col) * alpha;
+        const geometry_mask& g = FigureTable::find_shape(s.figure).rotations[s.rotation];
+        for (int r = 0; r < GEOMETRY_SIZE; ++r) {
+            for (int c = 0; c < GEOMETRY_SIZE; ++c) {
+                if (g.rows[r] >> c & 1) {
+                    AddBlock(row + r, col + c);
+                }
             }
         }
     }
 
+    //the whole well in one draw call
+    StreamInstanceOffsets(gWoodenCrate, gBlockOffsets);
+    RenderInstances(gWoodenCrate, (GLsizei) gBlockOffsets.size());
+
+    gRenderQueue.flush(gRenderState);
+    tdogl::RenderStats stats = gRenderState.endFrame();
+    gRenderTotals.draws += stats.draws;
+    gRenderTotals.issued += stats.issued;
+    gRenderTotals.elided += stats.elided;
+    ++gFrames;
 
     // swap the display buffers (displays what was just drawn)
     glfwSwapBuffers(gWindow);
+    gStream->endFrame();
+    if (s.keys != gShownKeys) {
+        if (s.key_time >= 0) {
+            gLatency.record(Simulation::clock() - s.key_time);
+        }
+        gShownKeys = s.keys;
+    }
+}
+
+static void PrintLatency() {
+    std::cout << "key to swap latency over " << gLatency.count() << " keys: p50 "
+            << gLatency.percentile(0.5) * 1000 << " ms, p99 " << gLatency.percentile(0.99) * 1000
+            << " ms, max " << gLatency.max() * 1000 << " ms" << std::endl;
+    if (gFrames) {
+        std::cout << "per frame over " << gFrames << " frames: " << (double) gRenderTotals.draws / gFrames
+                << " draws, " << (double) gRenderTotals.issued / gFrames << " state changes issued, "
+                << (double) gRenderTotals.elided / gFrames << " elided" << std::endl;
+    }
 }
 
-void update_game_state() {
-    if (GAME_OVER == game.process()) {
-        std::cout << "game is over" << std::endl;
-        exit(0);
+//seconds per frame drawing BENCH_BYTES of offsets, from gStream or uploaded to `vbo` with glBufferData
+
+static double BenchmarkFrames(const std::vector<glm::vec3>& offsets, GLuint vbo) {
+    glFinish();
+    double start = glfwGetTime();
+    for (int f = 0; f < BENCH_FRAMES; ++f) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (vbo) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof (glm::vec3), offsets.data(), GL_STREAM_DRAW);
+            BindInstanceOffsets(gWoodenCrate, vbo, 0);
+        } else {
+            StreamInstanceOffsets(gWoodenCrate, offsets);
+        }
+        RenderInstances(gWoodenCrate, (GLsizei) offsets.size());
+        gRenderQueue.flush(gRenderState);
+        gRenderState.endFrame();
+        glfwSwapBuffers(gWindow);
+        gStream->endFrame();
     }
+    glFinish();
+    return (glfwGetTime() - start) / BENCH_FRAMES;
 }
 
+//compares the upload of the instance offsets through gStream with a re-upload by glBufferData
+
+static void BenchmarkStreaming() {
+    std::vector<glm::vec3> offsets(BENCH_BYTES / sizeof (glm::vec3));
+    for (size_t k = 0; k < offsets.size(); ++k) {
+        offsets[k] = glm::vec3(k % GAME_FIELD_ROWS, k / GAME_FIELD_ROWS % GAME_FIELD_COLS, 0) * 2.0f;
+    }
+    //no waiting for the display, the frames take what the uploads and draws take
+    glfwSwapInterval(0);
+
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    double upload = BenchmarkFrames(offsets, vbo);
+    glDeleteBuffers(1, &vbo);
+    double stream = BenchmarkFrames(offsets, 0);
+
+    std::cout << BENCH_FRAMES << " frames of " << offsets.size() << " instances: glBufferData "
+            << upload * 1000 << " ms per frame, " << (gStream->isPersistent() ? "persistent" : "orphaned")
+            << " stream buffer " << stream * 1000 << " ms per frame" << std::endl;
+}
+
+//reacts to what the game did since the last frame
+static void HandleEvents() {
+    game_event e;
+    while (gGameEvents->pop(e)) {
+        switch (e.type) {
+            case EVENT_CLEARED:
+                std::cout << "score " << e.score << std::endl;
+                break;
+            case EVENT_GAME_OVER:
+                if (gViewer) {
+                    break;
+                }
+                std::cout << "game is over" << std::endl;
+                gSim->stop();
+                PrintLatency();
+                gReplay.finish(game.get_hash(), game.get_score());
+                gReplay.save(REPLAY_PATH);
+                exit(0);
+        }
+    }
+}
+
+//plays the next input of the bot, planning again once gravity moved the figure off the plan
+static bool PlayBot(tick_result& out) {
+    if (!gBot) {
+        BotConfig config;
+        //keeps a tick under 50 ms on slow machines, the game thread catches up after it
+        config.budget = 40;
+        gBot = new BeamSearchBot(config);
+    }
+    if (gPlanStep >= gPlan.length || game.get_hash() != gPlanHash) {
+        const figure_shape* preview[MAX_PREVIEW];
+        if (!gBot->think(game, gPlan, preview, game.get_preview(preview, MAX_PREVIEW))) {
+            return false;
+        }
+        gPlanStep = 0;
+    }
+    gReplay.play(game, (GameInput) gPlan.inputs[gPlanStep++], out);
+    gPlanHash = game.get_hash();
+    return true;
+}
+
+//plays the next step of the replay on view, one per tick
+static bool PlayViewer(tick_result& out) {
+    GameInput input;
+    if (!gViewer->next(input)) {
+        return false;
+    }
+    play_input(game, input, out);
+    return true;
+}
+
+static void SeekViewer(long long steps) {
+    long long target = std::max(0ll, std::min(gViewer->steps(), gViewer->position() + steps));
+    gViewer->seek(target, game);
+    std::cout << "replay step " << gViewer->position() << " of " << gViewer->steps() << std::endl;
+}
+
+static bool OpenViewer(const char* path) {
+    gViewerFile = new MappedFile(path);
+    gViewer = new ReplayReader(gViewerFile->data(), gViewerFile->size());
+    const replay_header& header = gViewer->header();
+    if (!gViewer->is_valid() || header.engine_version != ENGINE_VERSION
+            || header.rows != GAME_FIELD_ROWS || header.cols != GAME_FIELD_COLS) {
+        return false;
+    }
+    game = TetrisGame(header.queue());
+    return true;
+}
+
+/*
+ Plays the game on its own thread: the keyboard's inputs, the bot and the
+ gravity, or the replay on view. Everything the game does is recorded.
+ */
+class GameThread : public Simulation {
+public:
+    GameThread(const SimulationConfig& config) : Simulation(game, config) {
+    }
+
+protected:
+    virtual void step() {
+        if (gViewer) {
+            long long steps = gViewerSeek.exchange(0);
+            if (steps) {
+                SeekViewer(steps);
+                track(~0ull);
+            }
+            if (PlayViewer(changes)) {
+                track(changes);
+            }
+            return;
+        }
+        //the game over state is what the replay is finished with, see HandleEvents
+        if (is_over()) {
+            return;
+        }
+        if (gBotPlaying != gAutoplay) {
+            gBotPlaying = gAutoplay;
+            gPlanStep = gPlan.length = 0;
+        }
+        if (gBotPlaying && PlayBot(changes)) {
+            track(changes);
+        }
+        Simulation::step();
+    }
+
+    virtual ProcessResult play(GameInput input, tick_result& out) {
+        return gReplay.play(game, input, out);
+    }
+
+private:
+    //what the bot or the replay on view changed
+    tick_result changes;
+};
+
 // update the scene based on the time elapsed since last update
-float t = 0;
 
 static void Update(float secondsElapsed) {
+    HandleEvents();
 
 //        if (glfwGetKey(gWindow, 'W')) {
 //            game.rotate();
@@ -342,14 +676,6 @@ static void Update(float secondsElapsed) {
 //        
     
     
-    t += secondsElapsed;
-    if (t >= 1) {
-        for (int i = 1; i < t; ++i) {
-            update_game_state();
-        }
-        t = 0;
-    }
-
 
 
     //    switch (key) {
@@ -483,18 +809,44 @@ void OnError(int errorCode, const char* msg) {
     throw std::runtime_error(msg);
 }
 
+static bool KeyInput(int keyCode, GameInput& input) {
+    switch (keyCode) {
+        case GLFW_KEY_A: input = INPUT_LEFT;
+            return true;
+        case GLFW_KEY_D: input = INPUT_RIGHT;
+            return true;
+        case GLFW_KEY_W: input = INPUT_ROTATE;
+            return true;
+        case GLFW_KEY_S: input = INPUT_DROP;
+            return true;
+    }
+    return false;
+}
+
 void onKey(GLFWwindow* window, int keyCode, int b, int mode, int d) {
-    if (mode == GLFW_PRESS){
-        switch (keyCode) {
-            case GLFW_KEY_A: game.move_left();
-                break;
-            case GLFW_KEY_D: game.move_right();
-                break;
-            case GLFW_KEY_W: game.rotate();
-                break;
-            case GLFW_KEY_S: game.drop();
-                break;
+    if (gViewer) {
+        if (mode == GLFW_PRESS) {
+            switch (keyCode) {
+                case GLFW_KEY_RIGHT: gViewerSeek += VIEWER_SEEK_STEPS;
+                    break;
+                case GLFW_KEY_LEFT: gViewerSeek -= VIEWER_SEEK_STEPS;
+                    break;
+                case GLFW_KEY_HOME: gViewerSeek = -gViewer->steps();
+                    break;
+            }
         }
+        return;
+    }
+
+    //the game thread plays keys at the time they went down, and repeats held ones itself
+    GameInput input;
+    bool bound = KeyInput(keyCode, input);
+    if (bound && mode == GLFW_PRESS) {
+        gSim->press(input, Simulation::clock());
+    } else if (bound && mode == GLFW_RELEASE) {
+        gSim->release(input, Simulation::clock());
+    } else if (keyCode == GLFW_KEY_B && mode == GLFW_PRESS) {
+        gAutoplay = !gAutoplay;
     }
 }
 
@@ -541,6 +893,8 @@ void AppMain() {
     // make sure OpenGL version 3.2 API is available
     if (!GLEW_VERSION_3_2)
         throw std::runtime_error("OpenGL 3.2 API is not available.");
+    if (!GLEW_VERSION_3_3 && !GLEW_ARB_instanced_arrays)
+        throw std::runtime_error("Instanced arrays are not available.");
 
     // OpenGL settings
     glEnable(GL_DEPTH_TEST);
@@ -548,12 +902,15 @@ void AppMain() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // the per frame uniforms every program reads
+    gFrameUniforms = new tdogl::UniformBuffer(sizeof (FrameUniforms), FRAME_UNIFORMS_BINDING);
+
+    // the per frame vertex data
+    gStream = new tdogl::StreamBuffer(GL_ARRAY_BUFFER, STREAM_REGION_SIZE);
+
     // initialise the gWoodenCrate asset
     LoadWoodenCrateAsset();
 
-    // create all the instances in the 3D scene based on the gWoodenCrate asset
-    CreateInstances();
-
     // setup gCamera
     gCamera.setPosition(glm::vec3(0, 0, 50));
     gCamera.setViewportAspectRatio(SCREEN_SIZE.x / SCREEN_SIZE.y);
@@ -563,7 +920,14 @@ void AppMain() {
     gLight.position = gCamera.position();
     gLight.intensities = glm::vec3(1, 1, 1); //white
 
-    // run while the window is open
+    if (gBenchStream) {
+        BenchmarkStreaming();
+        glfwTerminate();
+        return;
+    }
+
+    // run while the window is open, the game on its own thread
+    gSim->start();
     float lastTime = (float) glfwGetTime();
     while (!glfwWindowShouldClose(gWindow)) {
         // process pending events
@@ -588,11 +952,27 @@ void AppMain() {
     }
 
     // clean up and exit
+    gSim->stop();
+    PrintLatency();
     glfwTerminate();
 }
 
 int main(int argc, char *argv[]) {
-    runTests();
+    if (argc > 1 && std::string(argv[1]) == "--bench-stream") {
+        gBenchStream = true;
+    } else if (argc > 1 && !OpenViewer(argv[1])) {
+        std::cerr << "ERROR: can not show replay " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    game.set_events(&gEvents);
+    SimulationConfig config;
+    if (gViewer) {
+        //the replay has its gravity ticks
+        config.gravity_ticks = 0;
+    }
+    gSim = new GameThread(config);
+    //nothing is drawn yet, every row of the first snapshot is new
+    std::fill(gRowTicks, gRowTicks + MAX_FIELD_ROWS, ~0ull);
     try {
         AppMain();
     } catch (const std::exception& e) {
@@ -31,20 +31,32 @@ Camera::Camera() :
     _fieldOfView(50.0f),
     _nearPlane(0.01f),
     _farPlane(100.0f),
-    _viewportAspectRatio(4.0f/3.0f)
+    _viewportAspectRatio(4.0f/3.0f),
+    _orientationDirty(true),
+    _projectionDirty(true),
+    _viewDirty(true),
+    _matrixDirty(true)
 {
 }
 
+void Camera::moved(bool turned) {
+    _orientationDirty = _orientationDirty || turned;
+    _viewDirty = true;
+    _matrixDirty = true;
+}
+
 const glm::vec3& Camera::position() const {
     return _position;
 }
 
 void Camera::setPosition(const glm::vec3& position) {
     _position = position;
+    moved(false);
 }
 
 void Camera::offsetPosition(const glm::vec3& offset) {
     _position += offset;
+    moved(false);
 }
 
 float Camera::fieldOfView() const {
@@ -54,6 +66,8 @@ float Camera::fieldOfView() const {
 void Camera::setFieldOfView(float fieldOfView) {
     assert(fieldOfView > 0.0f && fieldOfView < 180.0f);
     _fieldOfView = fieldOfView;
+    _projectionDirty = true;
+    _matrixDirty = true;
 }
 
 float Camera::nearPlane() const {
@@ -69,19 +83,25 @@ void Camera::setNearAndFarPlanes(float nearPlane, float farPlane) {
     assert(farPlane > nearPlane);
     _nearPlane = nearPlane;
     _farPlane = farPlane;
+    _projectionDirty = true;
+    _matrixDirty = true;
 }
 
-glm::mat4 Camera::orientation() const {
-    glm::mat4 orientation;
-    orientation = glm::rotate(orientation, glm::radians(_verticalAngle), glm::vec3(1,0,0));
-    orientation = glm::rotate(orientation, glm::radians(_horizontalAngle), glm::vec3(0,1,0));
-    return orientation;
+const glm::mat4& Camera::orientation() const {
+    if(_orientationDirty) {
+        _orientation = glm::mat4();
+        _orientation = glm::rotate(_orientation, glm::radians(_verticalAngle), glm::vec3(1,0,0));
+        _orientation = glm::rotate(_orientation, glm::radians(_horizontalAngle), glm::vec3(0,1,0));
+        _orientationDirty = false;
+    }
+    return _orientation;
 }
 
 void Camera::offsetOrientation(float upAngle, float rightAngle) {
     _horizontalAngle += rightAngle;
     _verticalAngle += upAngle;
     normalizeAngles();
+    moved(true);
 }
 
 void Camera::lookAt(glm::vec3 position) {
@@ -90,6 +110,7 @@ void Camera::lookAt(glm::vec3 position) {
     _verticalAngle = glm::degrees(asinf(-direction.y));
     _horizontalAngle = -glm::degrees(atan2f(-direction.x, -direction.z));
     normalizeAngles();
+    moved(true);
 }
 
 float Camera::viewportAspectRatio() const {
@@ -99,6 +120,8 @@ float Camera::viewportAspectRatio() const {
 void Camera::setViewportAspectRatio(float viewportAspectRatio) {
     assert(viewportAspectRatio > 0.0);
     _viewportAspectRatio = viewportAspectRatio;
+    _projectionDirty = true;
+    _matrixDirty = true;
 }
 
 glm::vec3 Camera::forward() const {
@@ -116,16 +139,28 @@ glm::vec3 Camera::up() const {
     return glm::vec3(up);
 }
 
-glm::mat4 Camera::matrix() const {
-    return projection() * view();
+const glm::mat4& Camera::matrix() const {
+    if(_matrixDirty) {
+        _matrix = projection() * view();
+        _matrixDirty = false;
+    }
+    return _matrix;
 }
 
-glm::mat4 Camera::projection() const {
-    return glm::perspective(glm::radians(_fieldOfView), _viewportAspectRatio, _nearPlane, _farPlane);
+const glm::mat4& Camera::projection() const {
+    if(_projectionDirty) {
+        _projection = glm::perspective(glm::radians(_fieldOfView), _viewportAspectRatio, _nearPlane, _farPlane);
+        _projectionDirty = false;
+    }
+    return _projection;
 }
 
-glm::mat4 Camera::view() const {
-    return orientation() * glm::translate(glm::mat4(), -_position);
+const glm::mat4& Camera::view() const {
+    if(_viewDirty) {
+        _view = orientation() * glm::translate(glm::mat4(), -_position);
+        _viewDirty = false;
+    }
+    return _view;
 }
 
 void Camera::normalizeAngles() {
@@ -30,6 +30,9 @@ namespace tdogl {
      use in the vertex shader.
 
      Includes the perspective projection matrix.
+
+     The matrices are computed when they are first asked for after a change and kept
+     until the next one.
      */
     class Camera {
     public:
@@ -88,7 +91,7 @@ namespace tdogl {
 
          Does not include translation (the camera's position).
          */
-        glm::mat4 orientation() const;
+        const glm::mat4& orientation() const;
 
         /**
          Offsets the cameras orientation.
@@ -129,12 +132,12 @@ namespace tdogl {
 
          This is the complete matrix to use in the vertex shader.
          */
-        glm::mat4 matrix() const;
+        const glm::mat4& matrix() const;
 
         /**
          The perspective projection transformation matrix
          */
-        glm::mat4 projection() const;
+        const glm::mat4& projection() const;
 
         /**
          The translation and rotation matrix of the camera.
@@ -142,7 +145,7 @@ namespace tdogl {
          Same as the `matrix` method, except the return value does not include the projection
          transformation.
          */
-        glm::mat4 view() const;
+        const glm::mat4& view() const;
 
     private:
         glm::vec3 _position;
@@ -153,6 +156,19 @@ namespace tdogl {
         float _farPlane;
         float _viewportAspectRatio;
 
+        //cached matrices, valid while the flags are clear
+        mutable glm::mat4 _orientation;
+        mutable glm::mat4 _projection;
+        mutable glm::mat4 _view;
+        mutable glm::mat4 _matrix;
+        mutable bool _orientationDirty;
+        mutable bool _projectionDirty;
+        mutable bool _viewDirty;
+        mutable bool _matrixDirty;
+
+        //the view moved, the orientation too when `turned`
+        void moved(bool turned);
+
         void normalizeAngles();
     };
 
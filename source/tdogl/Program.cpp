@@ -18,10 +18,16 @@
 
 #include "Program.h"
 #include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 
 using namespace tdogl;
 
+//the program use() made current, glUseProgram calls around tdogl::Program are not seen
+static GLuint programInUse = 0;
+
 Program::Program(const std::vector<Shader>& shaders) :
     _object(0)
 {
@@ -60,11 +66,100 @@ Program::Program(const std::vector<Shader>& shaders) :
         glDeleteProgram(_object); _object = 0;
         throw std::runtime_error(msg);
     }
+
+    _introspect();
+}
+
+void Program::_introspect() {
+    GLint maxLength = 0;
+    glGetProgramiv(_object, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    GLint attribMaxLength = 0;
+    glGetProgramiv(_object, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribMaxLength);
+    std::vector<GLchar> name(std::max(maxLength, attribMaxLength) + 1);
+
+    GLint count = 0;
+    glGetProgramiv(_object, GL_ACTIVE_UNIFORMS, &count);
+    for(GLint i = 0; i < count; ++i) {
+        ProgramVariable v;
+        glGetActiveUniform(_object, i, (GLsizei)name.size(), NULL, &v.size, &v.type, &name[0]);
+        v.name = &name[0];
+        v.location = glGetUniformLocation(_object, &name[0]);
+        //members of uniform blocks have no location of their own
+        if(v.location != -1)
+            _uniforms.push_back(v);
+    }
+
+    glGetProgramiv(_object, GL_ACTIVE_ATTRIBUTES, &count);
+    for(GLint i = 0; i < count; ++i) {
+        ProgramVariable v;
+        glGetActiveAttrib(_object, i, (GLsizei)name.size(), NULL, &v.size, &v.type, &name[0]);
+        v.name = &name[0];
+        v.location = glGetAttribLocation(_object, &name[0]);
+        //built in attributes like gl_VertexID have none either
+        if(v.location != -1)
+            _attributes.push_back(v);
+    }
+
+    //the elements of an array are not guaranteed to have consecutive locations
+    for(size_t i = 0; i < _uniforms.size(); ++i) {
+        const ProgramVariable& v = _uniforms[i];
+        _firstElement.push_back((GLint)_locations.size());
+        _locations.push_back(v.location);
+        std::string base = v.name.substr(0, v.name.rfind('['));
+        for(GLint element = 1; element < v.size; ++element) {
+            std::string elementName = base + "[" + std::to_string(element) + "]";
+            _locations.push_back(glGetUniformLocation(_object, elementName.c_str()));
+        }
+    }
+
+    _UploadedValue unknown;
+    unknown.bytes = 0;
+    _uploaded.assign(_locations.size(), unknown);
+}
+
+//arrays are reported as "name[0]" and can be looked up as "name" too
+static int findVariable(const std::vector<ProgramVariable>& variables, const GLchar* name, size_t length) {
+    for(size_t i = 0; i < variables.size(); ++i) {
+        const std::string& v = variables[i].name;
+        if(v.compare(0, length, name, length) == 0 && (v.size() == length || (v.size() == length + 3 && v.compare(length, 3, "[0]") == 0)))
+            return (int)i;
+    }
+    return -1;
+}
+
+static int findVariable(const std::vector<ProgramVariable>& variables, const GLchar* name) {
+    return findVariable(variables, name, std::strlen(name));
+}
+
+bool Program::_changed(UniformHandle uniform, const void* v, GLsizei bytes, GLboolean transpose, GLsizei count) {
+    //writes past the last element are left for the driver to reject
+    GLint first = _firstElement[uniform.index] + uniform.element;
+    GLint end = _firstElement[uniform.index] + _uniforms[uniform.index].size;
+    GLsizei elementBytes = count > 0 ? bytes / count : 0;
+    if(count <= 0 || first + count > end || elementBytes > (GLsizei)sizeof(_uploaded[0].value)) {
+        for(GLint i = first; i < std::min(first + std::max(count, 0), end); ++i)
+            _uploaded[i].bytes = 0;
+        return true;
+    }
+
+    bool changed = false;
+    const unsigned char* value = (const unsigned char*)v;
+    for(GLint i = first; i < first + count; ++i, value += elementBytes) {
+        _UploadedValue& last = _uploaded[i];
+        if(last.bytes == elementBytes && last.transpose == transpose && std::memcmp(last.value, value, elementBytes) == 0)
+            continue;
+        last.bytes = elementBytes;
+        last.transpose = transpose;
+        std::memcpy(last.value, value, elementBytes);
+        changed = true;
+    }
+    return changed;
 }
 
 Program::~Program() {
     //might be 0 if ctor fails by throwing exception
     if(_object != 0) glDeleteProgram(_object);
+    if(programInUse == _object) programInUse = 0;
 }
 
 GLuint Program::object() const {
@@ -73,39 +168,79 @@ GLuint Program::object() const {
 
 void Program::use() const {
     glUseProgram(_object);
+    programInUse = _object;
 }
 
 bool Program::isInUse() const {
-    GLint currentProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    return (currentProgram == (GLint)_object);
+    return programInUse == _object;
 }
 
 void Program::stopUsing() const {
     assert(isInUse());
     glUseProgram(0);
+    programInUse = 0;
 }
 
 GLint Program::attrib(const GLchar* attribName) const {
     if(!attribName)
         throw std::runtime_error("attribName was NULL");
     
-    GLint attrib = glGetAttribLocation(_object, attribName);
-    if(attrib == -1)
+    int i = findVariable(_attributes, attribName);
+    if(i == -1)
         throw std::runtime_error(std::string("Program attribute not found: ") + attribName);
     
-    return attrib;
+    return _attributes[i].location;
 }
 
 GLint Program::uniform(const GLchar* uniformName) const {
+    return uniformHandle(uniformName).location;
+}
+
+UniformHandle Program::uniformHandle(const GLchar* uniformName) const {
     if(!uniformName)
         throw std::runtime_error("uniformName was NULL");
     
-    GLint uniform = glGetUniformLocation(_object, uniformName);
-    if(uniform == -1)
+    UniformHandle handle;
+    handle.element = 0;
+    int i = findVariable(_uniforms, uniformName);
+    if(i == -1) {
+        //"name[N]", element N of an array
+        size_t length = std::strlen(uniformName);
+        const char* open = std::strrchr(uniformName, '[');
+        char* end = NULL;
+        long element = open ? std::strtol(open + 1, &end, 10) : -1;
+        if(open && end != open + 1 && end == uniformName + length - 1 && *end == ']' && element >= 0) {
+            i = findVariable(_uniforms, uniformName, open - uniformName);
+            if(i != -1 && element >= _uniforms[i].size)
+                i = -1;
+            handle.element = (GLint)element;
+        }
+    }
+    if(i == -1)
         throw std::runtime_error(std::string("Program uniform not found: ") + uniformName);
     
-    return uniform;
+    handle.location = _locations[_firstElement[i] + handle.element];
+    handle.index = i;
+    return handle;
+}
+
+const std::vector<ProgramVariable>& Program::uniforms() const {
+    return _uniforms;
+}
+
+const std::vector<ProgramVariable>& Program::attributes() const {
+    return _attributes;
+}
+
+void Program::bindUniformBlock(const GLchar* blockName, GLuint binding) {
+    if(!blockName)
+        throw std::runtime_error("blockName was NULL");
+    
+    GLuint block = glGetUniformBlockIndex(_object, blockName);
+    if(block == GL_INVALID_INDEX)
+        throw std::runtime_error(std::string("Program uniform block not found: ") + blockName);
+    
+    glUniformBlockBinding(_object, block, binding);
 }
 
 #define ATTRIB_N_UNIFORM_SETTERS(OGL_TYPE, TYPE_PREFIX, TYPE_SUFFIX) \
@@ -129,22 +264,40 @@ GLint Program::uniform(const GLchar* uniformName) const {
         { assert(isInUse()); glVertexAttrib ## TYPE_PREFIX ## 4 ## TYPE_SUFFIX ## v (attrib(name), v); } \
 \
     void Program::setUniform(const GLchar* name, OGL_TYPE v0) \
-        { assert(isInUse()); glUniform1 ## TYPE_SUFFIX (uniform(name), v0); } \
+        { setUniform(uniformHandle(name), v0); } \
     void Program::setUniform(const GLchar* name, OGL_TYPE v0, OGL_TYPE v1) \
-        { assert(isInUse()); glUniform2 ## TYPE_SUFFIX (uniform(name), v0, v1); } \
+        { setUniform(uniformHandle(name), v0, v1); } \
     void Program::setUniform(const GLchar* name, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2) \
-        { assert(isInUse()); glUniform3 ## TYPE_SUFFIX (uniform(name), v0, v1, v2); } \
+        { setUniform(uniformHandle(name), v0, v1, v2); } \
     void Program::setUniform(const GLchar* name, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2, OGL_TYPE v3) \
-        { assert(isInUse()); glUniform4 ## TYPE_SUFFIX (uniform(name), v0, v1, v2, v3); } \
+        { setUniform(uniformHandle(name), v0, v1, v2, v3); } \
 \
     void Program::setUniform1v(const GLchar* name, const OGL_TYPE* v, GLsizei count) \
-        { assert(isInUse()); glUniform1 ## TYPE_SUFFIX ## v (uniform(name), count, v); } \
+        { setUniform1v(uniformHandle(name), v, count); } \
     void Program::setUniform2v(const GLchar* name, const OGL_TYPE* v, GLsizei count) \
-        { assert(isInUse()); glUniform2 ## TYPE_SUFFIX ## v (uniform(name), count, v); } \
+        { setUniform2v(uniformHandle(name), v, count); } \
     void Program::setUniform3v(const GLchar* name, const OGL_TYPE* v, GLsizei count) \
-        { assert(isInUse()); glUniform3 ## TYPE_SUFFIX ## v (uniform(name), count, v); } \
+        { setUniform3v(uniformHandle(name), v, count); } \
     void Program::setUniform4v(const GLchar* name, const OGL_TYPE* v, GLsizei count) \
-        { assert(isInUse()); glUniform4 ## TYPE_SUFFIX ## v (uniform(name), count, v); }
+        { setUniform4v(uniformHandle(name), v, count); } \
+\
+    void Program::setUniform(UniformHandle u, OGL_TYPE v0) \
+        { assert(isInUse()); OGL_TYPE v[] = {v0}; if(_changed(u, v, sizeof(v))) glUniform1 ## TYPE_SUFFIX (u.location, v0); } \
+    void Program::setUniform(UniformHandle u, OGL_TYPE v0, OGL_TYPE v1) \
+        { assert(isInUse()); OGL_TYPE v[] = {v0, v1}; if(_changed(u, v, sizeof(v))) glUniform2 ## TYPE_SUFFIX (u.location, v0, v1); } \
+    void Program::setUniform(UniformHandle u, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2) \
+        { assert(isInUse()); OGL_TYPE v[] = {v0, v1, v2}; if(_changed(u, v, sizeof(v))) glUniform3 ## TYPE_SUFFIX (u.location, v0, v1, v2); } \
+    void Program::setUniform(UniformHandle u, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2, OGL_TYPE v3) \
+        { assert(isInUse()); OGL_TYPE v[] = {v0, v1, v2, v3}; if(_changed(u, v, sizeof(v))) glUniform4 ## TYPE_SUFFIX (u.location, v0, v1, v2, v3); } \
+\
+    void Program::setUniform1v(UniformHandle u, const OGL_TYPE* v, GLsizei count) \
+        { assert(isInUse()); if(_changed(u, v, 1 * count * sizeof(OGL_TYPE), GL_FALSE, count)) glUniform1 ## TYPE_SUFFIX ## v (u.location, count, v); } \
+    void Program::setUniform2v(UniformHandle u, const OGL_TYPE* v, GLsizei count) \
+        { assert(isInUse()); if(_changed(u, v, 2 * count * sizeof(OGL_TYPE), GL_FALSE, count)) glUniform2 ## TYPE_SUFFIX ## v (u.location, count, v); } \
+    void Program::setUniform3v(UniformHandle u, const OGL_TYPE* v, GLsizei count) \
+        { assert(isInUse()); if(_changed(u, v, 3 * count * sizeof(OGL_TYPE), GL_FALSE, count)) glUniform3 ## TYPE_SUFFIX ## v (u.location, count, v); } \
+    void Program::setUniform4v(UniformHandle u, const OGL_TYPE* v, GLsizei count) \
+        { assert(isInUse()); if(_changed(u, v, 4 * count * sizeof(OGL_TYPE), GL_FALSE, count)) glUniform4 ## TYPE_SUFFIX ## v (u.location, count, v); }
 
 ATTRIB_N_UNIFORM_SETTERS(GLfloat, , f);
 ATTRIB_N_UNIFORM_SETTERS(GLdouble, , d);
@@ -152,33 +305,27 @@ ATTRIB_N_UNIFORM_SETTERS(GLint, I, i);
 ATTRIB_N_UNIFORM_SETTERS(GLuint, I, ui);
 
 void Program::setUniformMatrix2(const GLchar* name, const GLfloat* v, GLsizei count, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix2fv(uniform(name), count, transpose, v);
+    setUniformMatrix2(uniformHandle(name), v, count, transpose);
 }
 
 void Program::setUniformMatrix3(const GLchar* name, const GLfloat* v, GLsizei count, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix3fv(uniform(name), count, transpose, v);
+    setUniformMatrix3(uniformHandle(name), v, count, transpose);
 }
 
 void Program::setUniformMatrix4(const GLchar* name, const GLfloat* v, GLsizei count, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix4fv(uniform(name), count, transpose, v);
+    setUniformMatrix4(uniformHandle(name), v, count, transpose);
 }
 
 void Program::setUniform(const GLchar* name, const glm::mat2& m, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix2fv(uniform(name), 1, transpose, glm::value_ptr(m));
+    setUniform(uniformHandle(name), m, transpose);
 }
 
 void Program::setUniform(const GLchar* name, const glm::mat3& m, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix3fv(uniform(name), 1, transpose, glm::value_ptr(m));
+    setUniform(uniformHandle(name), m, transpose);
 }
 
 void Program::setUniform(const GLchar* name, const glm::mat4& m, GLboolean transpose) {
-    assert(isInUse());
-    glUniformMatrix4fv(uniform(name), 1, transpose, glm::value_ptr(m));
+    setUniform(uniformHandle(name), m, transpose);
 }
 
 void Program::setUniform(const GLchar* uniformName, const glm::vec3& v) {
@@ -189,4 +336,40 @@ void Program::setUniform(const GLchar* uniformName, const glm::vec4& v) {
     setUniform4v(uniformName, glm::value_ptr(v));
 }
 
+void Program::setUniformMatrix2(UniformHandle u, const GLfloat* v, GLsizei count, GLboolean transpose) {
+    assert(isInUse());
+    if(_changed(u, v, 4 * count * sizeof(GLfloat), transpose, count))
+        glUniformMatrix2fv(u.location, count, transpose, v);
+}
+
+void Program::setUniformMatrix3(UniformHandle u, const GLfloat* v, GLsizei count, GLboolean transpose) {
+    assert(isInUse());
+    if(_changed(u, v, 9 * count * sizeof(GLfloat), transpose, count))
+        glUniformMatrix3fv(u.location, count, transpose, v);
+}
+
+void Program::setUniformMatrix4(UniformHandle u, const GLfloat* v, GLsizei count, GLboolean transpose) {
+    assert(isInUse());
+    if(_changed(u, v, 16 * count * sizeof(GLfloat), transpose, count))
+        glUniformMatrix4fv(u.location, count, transpose, v);
+}
+
+void Program::setUniform(UniformHandle u, const glm::mat2& m, GLboolean transpose) {
+    setUniformMatrix2(u, glm::value_ptr(m), 1, transpose);
+}
 
+void Program::setUniform(UniformHandle u, const glm::mat3& m, GLboolean transpose) {
+    setUniformMatrix3(u, glm::value_ptr(m), 1, transpose);
+}
+
+void Program::setUniform(UniformHandle u, const glm::mat4& m, GLboolean transpose) {
+    setUniformMatrix4(u, glm::value_ptr(m), 1, transpose);
+}
+
+void Program::setUniform(UniformHandle u, const glm::vec3& v) {
+    setUniform3v(u, glm::value_ptr(v));
+}
+
+void Program::setUniform(UniformHandle u, const glm::vec4& v) {
+    setUniform4v(u, glm::value_ptr(v));
+}
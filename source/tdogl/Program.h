@@ -20,12 +20,42 @@
 
 #include "Shader.h"
 #include <vector>
+#include <string>
 #include <glm/glm.hpp>
 
 namespace tdogl {
 
+    /**
+     An active uniform or attribute of a linked program, as glGetActiveUniform and
+     glGetActiveAttrib report it.
+     */
+    struct ProgramVariable {
+        std::string name;
+        GLenum type;
+        //elements, 1 unless the variable is an array
+        GLint size;
+        GLint location;
+    };
+
+    /**
+     A uniform looked up once with Program::uniformHandle(), for setters that are
+     called every frame.
+     */
+    struct UniformHandle {
+        GLint location;
+        //index into Program::uniforms()
+        GLint index;
+        //the array element the handle starts at, 0 for uniforms that are not arrays
+        GLint element;
+    };
+
     /**
      Represents an OpenGL program made by linking shaders.
+
+     The active uniforms and attributes are read once when the program is linked,
+     lookups by name search that table instead of asking the driver. The program
+     remembers the last value uploaded to each uniform, setters skip uploads that
+     would not change it.
      */
     class Program { 
     public:
@@ -49,6 +79,9 @@ namespace tdogl {
 
         void use() const;
 
+        /**
+         @result Whether use() made the program current, without asking the driver
+         */
         bool isInUse() const;
 
         void stopUsing() const;
@@ -64,6 +97,28 @@ namespace tdogl {
          */
         GLint uniform(const GLchar* uniformName) const;
 
+        /**
+         @param uniformName  The uniform, "name[N]" for element N of an array
+         @result The uniform for the given name, to set it without looking it up again.
+
+         @throws std::exception if the program has no such active uniform or array element.
+         */
+        UniformHandle uniformHandle(const GLchar* uniformName) const;
+
+        /**
+         @result The active uniforms and attributes, in the order the driver reports them.
+         */
+        const std::vector<ProgramVariable>& uniforms() const;
+        const std::vector<ProgramVariable>& attributes() const;
+
+        /**
+         Connects the uniform block `blockName` to a uniform buffer binding point,
+         see tdogl::UniformBuffer.
+
+         @throws std::exception if the program has no such active uniform block.
+         */
+        void bindUniformBlock(const GLchar* blockName, GLuint binding);
+
         /**
          Setters for attribute and uniform variables.
 
@@ -89,6 +144,16 @@ namespace tdogl {
         void setUniform2v(const GLchar* uniformName, const OGL_TYPE* v, GLsizei count=1); \
         void setUniform3v(const GLchar* uniformName, const OGL_TYPE* v, GLsizei count=1); \
         void setUniform4v(const GLchar* uniformName, const OGL_TYPE* v, GLsizei count=1); \
+\
+        void setUniform(UniformHandle uniform, OGL_TYPE v0); \
+        void setUniform(UniformHandle uniform, OGL_TYPE v0, OGL_TYPE v1); \
+        void setUniform(UniformHandle uniform, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2); \
+        void setUniform(UniformHandle uniform, OGL_TYPE v0, OGL_TYPE v1, OGL_TYPE v2, OGL_TYPE v3); \
+\
+        void setUniform1v(UniformHandle uniform, const OGL_TYPE* v, GLsizei count=1); \
+        void setUniform2v(UniformHandle uniform, const OGL_TYPE* v, GLsizei count=1); \
+        void setUniform3v(UniformHandle uniform, const OGL_TYPE* v, GLsizei count=1); \
+        void setUniform4v(UniformHandle uniform, const OGL_TYPE* v, GLsizei count=1); \
 
         _TDOGL_PROGRAM_ATTRIB_N_UNIFORM_SETTERS(GLfloat)
         _TDOGL_PROGRAM_ATTRIB_N_UNIFORM_SETTERS(GLdouble)
@@ -104,9 +169,36 @@ namespace tdogl {
         void setUniform(const GLchar* uniformName, const glm::vec3& v);
         void setUniform(const GLchar* uniformName, const glm::vec4& v);
 
+        void setUniformMatrix2(UniformHandle uniform, const GLfloat* v, GLsizei count=1, GLboolean transpose=GL_FALSE);
+        void setUniformMatrix3(UniformHandle uniform, const GLfloat* v, GLsizei count=1, GLboolean transpose=GL_FALSE);
+        void setUniformMatrix4(UniformHandle uniform, const GLfloat* v, GLsizei count=1, GLboolean transpose=GL_FALSE);
+        void setUniform(UniformHandle uniform, const glm::mat2& m, GLboolean transpose=GL_FALSE);
+        void setUniform(UniformHandle uniform, const glm::mat3& m, GLboolean transpose=GL_FALSE);
+        void setUniform(UniformHandle uniform, const glm::mat4& m, GLboolean transpose=GL_FALSE);
+        void setUniform(UniformHandle uniform, const glm::vec3& v);
+        void setUniform(UniformHandle uniform, const glm::vec4& v);
+
         
     private:
+        //the last value uploaded to an element of a uniform, values bigger than a dmat4 are not kept
+        struct _UploadedValue {
+            GLsizei bytes;
+            GLboolean transpose;
+            unsigned char value[16 * sizeof(GLdouble)];
+        };
+
         GLuint _object;
+        std::vector<ProgramVariable> _uniforms;
+        std::vector<ProgramVariable> _attributes;
+        //every element of every uniform, those of _uniforms[i] start at _firstElement[i]
+        std::vector<GLint> _locations;
+        std::vector<GLint> _firstElement;
+        std::vector<_UploadedValue> _uploaded;
+
+        void _introspect();
+        //true when the `count` elements of `v` differ from the last values uploaded to the elements
+        //of `uniform`, which they become
+        bool _changed(UniformHandle uniform, const void* v, GLsizei bytes, GLboolean transpose=GL_FALSE, GLsizei count=1);
         
         //copying disabled
         Program(const Program&);
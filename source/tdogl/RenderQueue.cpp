@@ -0,0 +1,123 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace tdogl;
+
+RenderState::RenderState()
+{
+    reset();
+    endFrame();
+}
+
+void RenderState::useProgram(const Program* program)
+{
+    if(program == _program) {
+        ++_stats.elided;
+        return;
+    }
+    program->use();
+    _program = program;
+    ++_stats.issued;
+}
+
+void RenderState::bindTexture(GLuint unit, GLuint texture)
+{
+    assert(unit < RENDER_TEXTURE_UNITS);
+    if(_textures[unit] == texture) {
+        ++_stats.elided;
+        return;
+    }
+    if(_activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        _activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    _textures[unit] = texture;
+    ++_stats.issued;
+}
+
+void RenderState::bindVertexArray(GLuint vao)
+{
+    if(vao == _vao) {
+        ++_stats.elided;
+        return;
+    }
+    glBindVertexArray(vao);
+    _vao = vao;
+    ++_stats.issued;
+}
+
+void RenderState::drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+    if(instances != 1)
+        glDrawArraysInstanced(mode, first, count, instances);
+    else
+        glDrawArrays(mode, first, count);
+    ++_stats.draws;
+}
+
+void RenderState::reset()
+{
+    //names no object has, so the next binds are issued
+    _program = NULL;
+    for(int i = 0; i < RENDER_TEXTURE_UNITS; ++i)
+        _textures[i] = ~0u;
+    _activeUnit = ~0u;
+    _vao = ~0u;
+}
+
+const RenderStats& RenderState::stats() const
+{
+    return _stats;
+}
+
+RenderStats RenderState::endFrame()
+{
+    RenderStats frame = _stats;
+    _stats.draws = 0;
+    _stats.issued = 0;
+    _stats.elided = 0;
+    return frame;
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+uint64_t RenderQueue::sortKey(const Program* program, GLuint texture, GLuint vao, float depth)
+{
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    return (uint64_t)(program->object() & 0xFFFF) << 48
+        | (uint64_t)(texture & 0xFFFF) << 32
+        | (uint64_t)(vao & 0xFFFF) << 16
+        | (uint64_t)(depth * 0xFFFF);
+}
+
+void RenderQueue::submit(const DrawCommand& command)
+{
+    _order.push_back(std::make_pair(command.key, _commands.size()));
+    _commands.push_back(command);
+}
+
+void RenderQueue::flush(RenderState& state)
+{
+    //the index breaks ties, so equal keys keep their order
+    std::sort(_order.begin(), _order.end());
+    for(size_t i = 0; i < _order.size(); ++i) {
+        const DrawCommand& c = _commands[_order[i].second];
+        state.useProgram(c.program);
+        if(c.modelUniform.location != -1)
+            c.program->setUniform(c.modelUniform, c.model);
+        state.bindTexture(0, c.texture);
+        state.bindVertexArray(c.vao);
+        state.drawArrays(c.drawType, c.drawStart, c.drawCount, c.instances);
+    }
+    _order.clear();
+    _commands.clear();
+}
+
+size_t RenderQueue::size() const
+{
+    return _commands.size();
+}
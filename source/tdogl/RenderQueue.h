@@ -0,0 +1,125 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+#include "Program.h"
+
+//texture units tdogl::RenderState keeps track of
+#define RENDER_TEXTURE_UNITS 8
+
+namespace tdogl {
+
+    /**
+     State changes asked of a tdogl::RenderState, issued to OpenGL or elided because
+     they would not have changed anything.
+     */
+    struct RenderStats {
+        unsigned draws;
+        unsigned issued;
+        unsigned elided;
+    };
+
+    /**
+     Binds programs, textures and vertex arrays only when they differ from what is bound.
+
+     Nothing is unbound after a draw, the next draw binds what it needs. RenderState
+     knows what is bound only as far as it bound it itself, code that binds around it
+     has to call reset() afterwards.
+     */
+    class RenderState {
+    public:
+        RenderState();
+
+        void useProgram(const Program* program);
+        void bindTexture(GLuint unit, GLuint texture);
+        void bindVertexArray(GLuint vao);
+
+        /**
+         Draws with glDrawArrays, or glDrawArraysInstanced unless `instances` is 1
+         */
+        void drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instances = 1);
+
+        /**
+         Forgets what is bound, the next calls issue their binds
+         */
+        void reset();
+
+        /**
+         @result The counters of the frame so far
+         */
+        const RenderStats& stats() const;
+
+        /**
+         @result The counters of the frame, which start over for the next one
+         */
+        RenderStats endFrame();
+
+    private:
+        const Program* _program;
+        GLuint _textures[RENDER_TEXTURE_UNITS];
+        GLuint _activeUnit;
+        GLuint _vao;
+        RenderStats _stats;
+    };
+
+    /**
+     One draw of a tdogl::RenderQueue
+     */
+    struct DrawCommand {
+        //order of the draw, see RenderQueue::sortKey
+        uint64_t key;
+        Program* program;
+        //bound to GL_TEXTURE0, 0 for none
+        GLuint texture;
+        GLuint vao;
+        GLenum drawType;
+        GLint drawStart;
+        GLsizei drawCount;
+        //drawn with glDrawArraysInstanced unless it is 1
+        GLsizei instances;
+        //per object transform, set when modelUniform.location is not -1
+        UniformHandle modelUniform;
+        glm::mat4 model;
+    };
+
+    /**
+     Collects the draws of a frame and issues them sorted by their keys, so draws that
+     share a program, a texture or a vertex array follow each other and a
+     tdogl::RenderState can skip binding them again.
+     */
+    class RenderQueue {
+    public:
+        RenderQueue();
+
+        /**
+         A key sorting draws by program, then texture, then vertex array, then front
+         to back by `depth`, which is clamped to 0..1.
+
+         Each part takes 16 bits, objects with names that collide there are only
+         sorted together, the draws stay correct.
+         */
+        static uint64_t sortKey(const Program* program, GLuint texture, GLuint vao, float depth);
+
+        void submit(const DrawCommand& command);
+
+        /**
+         Issues the submitted draws in key order through `state` and empties the queue.
+         Draws with equal keys keep the order they were submitted in.
+         */
+        void flush(RenderState& state);
+
+        size_t size() const;
+
+    private:
+        std::vector<DrawCommand> _commands;
+        //keys and command indices, sorted instead of the commands
+        std::vector<std::pair<uint64_t, size_t> > _order;
+
+        //copying disabled
+        RenderQueue(const RenderQueue&);
+        const RenderQueue& operator=(const RenderQueue&);
+    };
+
+}
@@ -0,0 +1,126 @@
+#include "StreamBuffer.h"
+#include <stdexcept>
+
+using namespace tdogl;
+
+//nanoseconds a wait for a fence takes before it is tried again
+static const GLuint64 FenceTimeout = 1000000;
+
+static GLsizeiptr Aligned(GLsizeiptr bytes) {
+    return (bytes + STREAM_BUFFER_ALIGNMENT - 1) & ~(GLsizeiptr)(STREAM_BUFFER_ALIGNMENT - 1);
+}
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr regionSize, bool persistent) :
+    _target(target),
+    _regionSize(Aligned(regionSize)),
+    _persistent(persistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)),
+    _object(0),
+    _mapped(NULL),
+    _region(0),
+    _cursor(0),
+    _mapping(false)
+{
+    for(int i = 0; i < STREAM_BUFFER_REGIONS; ++i)
+        _fences[i] = 0;
+
+    glGenBuffers(1, &_object);
+    glBindBuffer(_target, _object);
+    if(_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(_target, STREAM_BUFFER_REGIONS * _regionSize, NULL, flags);
+        _mapped = (unsigned char*)glMapBufferRange(_target, 0, STREAM_BUFFER_REGIONS * _regionSize, flags);
+        if(!_mapped)
+            throw std::runtime_error("glMapBufferRange failed for a persistent stream buffer");
+    } else {
+        glBufferData(_target, _regionSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(_target, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for(int i = 0; i < STREAM_BUFFER_REGIONS; ++i) {
+        if(_fences[i])
+            glDeleteSync(_fences[i]);
+    }
+    if(_mapped) {
+        glBindBuffer(_target, _object);
+        glUnmapBuffer(_target);
+        glBindBuffer(_target, 0);
+    }
+    glDeleteBuffers(1, &_object);
+}
+
+GLuint StreamBuffer::object() const
+{
+    return _object;
+}
+
+bool StreamBuffer::isPersistent() const
+{
+    return _persistent;
+}
+
+GLvoid* StreamBuffer::map(GLsizeiptr bytes, GLintptr& offset)
+{
+    //the attribute offsets of the users after this one stay aligned
+    GLsizeiptr start = Aligned(_cursor);
+    if(start + bytes > _regionSize)
+        throw std::runtime_error("stream buffer region is full");
+
+    glBindBuffer(_target, _object);
+    GLvoid* p;
+    if(_persistent) {
+        offset = _region * _regionSize + start;
+        p = _mapped + offset;
+    } else if(bytes == 0) {
+        //glMapBufferRange fails on an empty range
+        offset = start;
+        p = NULL;
+    } else {
+        //the ranges of a frame never overlap and the last frame's data was orphaned
+        offset = start;
+        p = glMapBufferRange(_target, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if(!p)
+            throw std::runtime_error("glMapBufferRange failed for a stream buffer");
+        _mapping = true;
+    }
+    _cursor = start + bytes;
+    return p;
+}
+
+void StreamBuffer::unmap()
+{
+    //coherent writes reach the GPU without it
+    if(_mapping) {
+        glUnmapBuffer(_target);
+        _mapping = false;
+    }
+}
+
+void StreamBuffer::endFrame()
+{
+    _cursor = 0;
+    if(!_persistent) {
+        glBindBuffer(_target, _object);
+        glBufferData(_target, _regionSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(_target, 0);
+        return;
+    }
+
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % STREAM_BUFFER_REGIONS;
+    GLsync fence = _fences[_region];
+    if(!fence)
+        return;
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(true) {
+        GLenum result = glClientWaitSync(fence, flags, FenceTimeout);
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+            break;
+        //the commands are flushed by the first wait
+        flags = 0;
+    }
+    glDeleteSync(fence);
+    _fences[_region] = 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <GL/glew.h>
+
+//frames a StreamBuffer can be ahead of the GPU
+#define STREAM_BUFFER_REGIONS 3
+//bytes every range map() hands out is aligned to, enough for any vertex attribute
+#define STREAM_BUFFER_ALIGNMENT 16
+
+namespace tdogl {
+
+    /**
+     A buffer for data written anew every frame, like instance attributes, without
+     the driver stalling on data the GPU still reads.
+
+     Every frame writes to a region of its own: with GL_ARB_buffer_storage the buffer
+     holds STREAM_BUFFER_REGIONS regions mapped once, persistently and coherently,
+     and a fence taken when a frame ends guards its region until the GPU is done
+     with it. Without it, as on the OpenGL 3.2 contexts AppMain asks for, the buffer
+     is one region that is orphaned with glBufferData when a frame ends, and map()
+     maps ranges of it unsynchronized.
+
+     Several users can share the buffer, each map() takes the next range of the
+     region of the frame, starting on a multiple of STREAM_BUFFER_ALIGNMENT bytes.
+     */
+    class StreamBuffer {
+    public:
+        /**
+         @param target      The binding target, for example GL_ARRAY_BUFFER
+         @param regionSize  The bytes a frame can write, rounded up to STREAM_BUFFER_ALIGNMENT
+         @param persistent  Use persistent mapping when it is available
+         */
+        StreamBuffer(GLenum target, GLsizeiptr regionSize, bool persistent = true);
+        
+        /**
+         Deletes the buffer object and the fences
+         */
+        ~StreamBuffer();
+        
+        /**
+         @result The buffer object, as created by glGenBuffers
+         */
+        GLuint object() const;
+
+        /**
+         @result Whether the buffer is mapped persistently, false when it is orphaned
+         */
+        bool isPersistent() const;
+
+        /**
+         Takes `bytes` of the region of the frame and binds the buffer to the target.
+         
+         @param offset  Set to where the bytes start in the buffer, for glVertexAttribPointer
+         @result Where to write the bytes, valid until unmap(). NULL when `bytes` is 0 and
+                 the buffer is orphaned, nothing is mapped then.
+         
+         @throws std::exception if the frame wrote more than the region holds.
+         */
+        GLvoid* map(GLsizeiptr bytes, GLintptr& offset);
+
+        /**
+         Ends writing the range map() returned, before drawing from it
+         */
+        void unmap();
+
+        /**
+         Ends the frame. Fences its region and waits until the GPU is done with the
+         region of the next frame, or orphans the buffer.
+         */
+        void endFrame();
+        
+    private:
+        GLenum _target;
+        GLsizeiptr _regionSize;
+        bool _persistent;
+        GLuint _object;
+        //the whole buffer, mapped once when persistent
+        unsigned char* _mapped;
+        GLsync _fences[STREAM_BUFFER_REGIONS];
+        int _region;
+        GLsizeiptr _cursor;
+        //a range is mapped until unmap(), never when persistent
+        bool _mapping;
+        
+        //copying disabled
+        StreamBuffer(const StreamBuffer&);
+        const StreamBuffer& operator=(const StreamBuffer&);
+    };
+    
+}
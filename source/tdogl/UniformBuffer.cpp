@@ -0,0 +1,37 @@
+#include "UniformBuffer.h"
+
+using namespace tdogl;
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, GLuint binding) :
+    _object(0),
+    _size(size),
+    _binding(binding)
+{
+    glGenBuffers(1, &_object);
+    glBindBuffer(GL_UNIFORM_BUFFER, _object);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, _object);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &_object);
+}
+
+GLuint UniformBuffer::object() const
+{
+    return _object;
+}
+
+GLuint UniformBuffer::binding() const
+{
+    return _binding;
+}
+
+void UniformBuffer::update(const GLvoid* data)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, _object);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, _size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>
+
+namespace tdogl {
+
+    /**
+     Represents an OpenGL uniform buffer bound to a uniform block binding point.
+
+     Programs connect a uniform block to the binding point with
+     Program::bindUniformBlock, then every program reads the same data and it is
+     uploaded once for all of them. The data has to be laid out as the block
+     declares it, with layout(std140) that layout does not depend on the driver.
+     */
+    class UniformBuffer {
+    public:
+        /**
+         Creates a buffer of `size` bytes and binds it to `binding`
+         
+         @param size     The size of the uniform block in bytes
+         @param binding  The uniform block binding point, below GL_MAX_UNIFORM_BUFFER_BINDINGS
+         */
+        UniformBuffer(GLsizeiptr size, GLuint binding);
+        
+        /**
+         Deletes the buffer object with glDeleteBuffers
+         */
+        ~UniformBuffer();
+        
+        /**
+         @result The buffer object, as created by glGenBuffers
+         */
+        GLuint object() const;
+
+        GLuint binding() const;
+
+        /**
+         Replaces the whole contents of the buffer, `data` has to be as big as the buffer
+         */
+        void update(const GLvoid* data);
+        
+    private:
+        GLuint _object;
+        GLsizeiptr _size;
+        GLuint _binding;
+        
+        //copying disabled
+        UniformBuffer(const UniformBuffer&);
+        const UniformBuffer& operator=(const UniformBuffer&);
+    };
+    
+}